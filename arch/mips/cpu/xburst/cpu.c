@@ -98,30 +98,97 @@ int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	return 0;
 }
 
+/*
+ * Walking a range by hit ops costs one cache op per line whether the line
+ * is cached or not; once the range is as large as the D-cache, an index
+ * walk over the whole cache is cheaper and has the same effect.
+ */
+#define CACHE_RANGE_MAX		CONFIG_SYS_DCACHE_SIZE
+
+static void __flush_dcache_index(void)
+{
+	u32 addr;
+
+	for (addr = CKSEG0; addr < CKSEG0 + CONFIG_SYS_DCACHE_SIZE;
+	     addr += CONFIG_SYS_CACHELINE_SIZE) {
+		cache_op(INDEX_WRITEBACK_INV_D, addr);
+	}
+}
+
+/*
+ * Drain the write buffer: the sync orders the writebacks and the uncached
+ * load only completes once they reached the DDR. Callers of the _nosync
+ * variants issue this once before handing the buffers to a DMA master.
+ */
+void cache_sync(void)
+{
+	fast_iob();
+}
+
 void flush_cache(ulong start_addr, ulong size)
 {
 	unsigned long lsize = CONFIG_SYS_CACHELINE_SIZE;
 	unsigned long addr = start_addr & ~(lsize - 1);
 	unsigned long aend = (start_addr + size - 1) & ~(lsize - 1);
 
+	if (size >= CACHE_RANGE_MAX) {
+		flush_cache_all();
+		return;
+	}
+
 	for (; addr <= aend; addr += lsize) {
 		cache_op(HIT_WRITEBACK_INV_D, addr);
 		cache_op(HIT_INVALIDATE_I, addr);
 	}
+	__sync();
 }
 
-void flush_dcache_range(ulong start_addr, ulong stop)
+void flush_dcache_range_nosync(ulong start_addr, ulong stop)
 {
 	unsigned long lsize = CONFIG_SYS_CACHELINE_SIZE;
 	unsigned long addr = start_addr & ~(lsize - 1);
 	unsigned long aend = (stop - 1) & ~(lsize - 1);
-	unsigned int writebuffer;
+
+	if (stop - start_addr >= CACHE_RANGE_MAX) {
+		__flush_dcache_index();
+		return;
+	}
+
 	for (; addr <= aend; addr += lsize)
 		cache_op(HIT_WRITEBACK_INV_D, addr);
-	__asm__ __volatile__("sync");
-	writebuffer = *(volatile unsigned int *)0xa0000000;
 }
 
+void flush_dcache_range(ulong start_addr, ulong stop)
+{
+	flush_dcache_range_nosync(start_addr, stop);
+	cache_sync();
+}
+
+/*
+ * Write dirty lines back but keep them valid, for buffers the CPU goes on
+ * reading after a device has fetched them. XBurst implements Hit_Writeback_D.
+ * There is no index writeback without invalidate, so a range as large as
+ * the cache still ends up written back and invalidated.
+ */
+void writeback_dcache_range(ulong start_addr, ulong stop)
+{
+	unsigned long lsize = CONFIG_SYS_CACHELINE_SIZE;
+	unsigned long addr = start_addr & ~(lsize - 1);
+	unsigned long aend = (stop - 1) & ~(lsize - 1);
+
+	if (stop - start_addr >= CACHE_RANGE_MAX) {
+		__flush_dcache_index();
+	} else {
+		for (; addr <= aend; addr += lsize)
+			cache_op(HIT_WRITEBACK_D, addr);
+	}
+	cache_sync();
+}
+
+/*
+ * No index shortcut here: an index invalidate would drop dirty lines that
+ * belong to other buffers.
+ */
 void invalidate_dcache_range(ulong start_addr, ulong stop)
 {
 	unsigned long lsize = CONFIG_SYS_CACHELINE_SIZE;
@@ -158,13 +225,7 @@ void flush_icache_all(void)
 
 void flush_dcache_all(void)
 {
-	u32 addr;
-
-	for (addr = CKSEG0; addr < CKSEG0 + CONFIG_SYS_DCACHE_SIZE;
-	     addr += CONFIG_SYS_CACHELINE_SIZE) {
-		cache_op(INDEX_WRITEBACK_INV_D, addr);
-	}
-
+	__flush_dcache_index();
 	fast_iob();
 }
 
@@ -25,13 +25,13 @@
  * MA 02111-1307 USA
  */
 
-#define DEBUG
 #include <config.h>
 #include <common.h>
 #include <asm/io.h>
 #include <ddr/ddr_common.h>
 #include <generated/ddr_reg_values.h>
-#if defined(CONFIG_DDR_TEST_DMA) || defined(CONFIG_DDR_TEST_CPU_DMA)
+#if defined(CONFIG_DDR_TEST_DMA) || defined(CONFIG_DDR_TEST_CPU_DMA) || \
+	defined(CONFIG_DDR_TEST_PARALLEL)
 #include <asm/arch/dma.h>
 #endif
 #include <asm/arch/cpm.h>
@@ -687,6 +687,332 @@ static void dcache_sync(void)
 #endif /* CONFIG_DDR_TEST_CACHE */
 #endif
 
+#ifdef CONFIG_DDR_TEST_PARALLEL
+/*
+ * Manufacturing test: DRAM is cut into DDRT_NR_REGIONS regions and each
+ * pass gives half of them a PDMA written pattern and the other half a
+ * CPU pattern. While the CPU runs its pattern on one region the PDMA
+ * fills the next one, and while the CPU checks a PDMA filled region the
+ * PDMA already fills the following one. The PDMA cannot compare, all
+ * checks are done by the CPU through the cache.
+ *
+ * The bottom DDRT_SCRATCH of DRAM holds the descriptor page and the
+ * pattern block the PDMA replicates, the test starts above it.
+ */
+#ifndef CONFIG_DDR_TEST_PARALLEL_SIZE
+#define CONFIG_DDR_TEST_PARALLEL_SIZE	(64 * 1024 * 1024)
+#endif
+#ifndef CONFIG_DDR_TEST_PARALLEL_MS
+#define CONFIG_DDR_TEST_PARALLEL_MS	3000	/* whole test budget */
+#endif
+
+#define DDRT_NR_REGIONS		16
+#define DDRT_NR_DESC		(4096 / sizeof(struct jz_dma_desc))
+#define DDRT_SCRATCH		0x100000
+#define DDRT_DMA_CHAN		3
+#define DDRT_MAX_REPORT		8
+#define DDRT_MOVINV		0x55555555
+
+enum ddrt_pattern {
+	DDRT_WALK1,		/* PDMA: 1 << word index */
+	DDRT_WALK0,		/* PDMA: ~(1 << word index) */
+	DDRT_ADDR,		/* CPU: address in address */
+	DDRT_MOVINV_P,		/* CPU: moving inversions march */
+};
+
+static const char * const ddrt_name[] = {
+	"walking ones", "walking zeros", "address", "moving inversions",
+};
+
+/* a pass pairs a PDMA pattern with a CPU one, odd passes swap the halves */
+static const struct {
+	enum ddrt_pattern dma, cpu;
+} ddrt_pass[] = {
+	{ DDRT_WALK1, DDRT_ADDR },
+	{ DDRT_WALK1, DDRT_ADDR },
+	{ DDRT_WALK0, DDRT_MOVINV_P },
+	{ DDRT_WALK0, DDRT_MOVINV_P },
+};
+
+struct ddrt {
+	unsigned int base;		/* KSEG0 address of region 0 */
+	unsigned int region;		/* bytes per region */
+	unsigned int block;		/* bytes per PDMA descriptor */
+	struct jz_dma_desc *desc;	/* KSEG1 */
+	unsigned int *block_buf;	/* KSEG1 */
+	unsigned int row, col, bank8, dw32;
+	unsigned int remap[20];
+	unsigned int errors;
+	unsigned int done;		/* regions written and checked */
+	ulong start;			/* get_timer() base of the budget */
+};
+
+static inline unsigned int ddrt_walk(unsigned int addr)
+{
+	return 1 << ((addr >> 2) & 31);
+}
+
+/* DDR address bit 12 + i is driven by CPU address bit 12 + remap[i] */
+static void ddrt_report(struct ddrt *t, unsigned int addr,
+			unsigned int want, unsigned int got,
+			enum ddrt_pattern pat)
+{
+	unsigned int phys = addr & 0x1fffffff, ddr = phys & 0xfff;
+	unsigned int bw = t->dw32 ? 2 : 1;
+	unsigned int i;
+
+	if (t->errors++ >= DDRT_MAX_REPORT)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(t->remap); i++)
+		if (phys & (1 << (12 + t->remap[i])))
+			ddr |= 1 << (12 + i);
+
+	printf("Error: %s at 0x%x, want 0x%08x got 0x%08x (xor 0x%08x)\n",
+	       ddrt_name[pat], phys, want, got, want ^ got);
+	printf("       cs %d bank %d row 0x%x col 0x%x\n",
+	       ddr >> (bw + t->col + t->row + (t->bank8 ? 3 : 2)),
+	       (ddr >> (bw + t->col + t->row)) & (t->bank8 ? 7 : 3),
+	       (ddr >> (bw + t->col)) & ((1 << t->row) - 1),
+	       (ddr >> bw) & ((1 << t->col) - 1));
+}
+
+static void ddrt_dma_fill(struct ddrt *t, unsigned int addr,
+			  enum ddrt_pattern pat)
+{
+	unsigned int ch = JZ_DMA_CH(DDRT_DMA_CHAN);
+	unsigned int nr = t->region / t->block;
+	unsigned int i, w;
+
+	for (i = 0; i < t->block / 4; i++) {
+		w = ddrt_walk(i * 4);
+		t->block_buf[i] = pat == DDRT_WALK0 ? ~w : w;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct jz_dma_desc *d = &t->desc[i];
+
+		d->dcm = DMAC_DCMD_SAI | DMAC_DCMD_DAI | DMAC_DCMD_DS_32BYTE;
+		d->dsa = virt_to_phys(t->block_buf);
+		d->dta = virt_to_phys((void *)(addr + i * t->block));
+		d->dtc = t->block / 32;
+		d->sd = 0;
+		d->drt = DMAC_DRSR_RS_AUTO;
+		if (i + 1 < nr) {
+			d->dcm |= DMAC_DCMD_LINK;
+			d->dtc |= ((virt_to_phys(d + 1) >> 4) & 0xff) << 24;
+		}
+	}
+
+	writel(0, ch + CH_DCS);
+	writel(virt_to_phys(t->desc), ch + CH_DDA);
+	writel(1 << DDRT_DMA_CHAN, PDMA_BASE + DDRS);
+	writel(DMAC_DCCSR_DES8 | DMAC_DCCSR_EN, ch + CH_DCS);
+}
+
+static int ddrt_dma_wait(void)
+{
+	unsigned int ch = JZ_DMA_CH(DDRT_DMA_CHAN);
+	unsigned int dcs;
+
+	while (!((dcs = readl(ch + CH_DCS)) & (DMAC_DCCSR_TT | DMAC_DCCSR_AR)))
+		;
+	writel(0, ch + CH_DCS);
+	if (dcs & DMAC_DCCSR_AR) {
+		printf("Error: PDMA address error\n");
+		writel(readl(PDMA_BASE + DMAC) & ~(DMAC_AR | DMAC_HLT),
+		       PDMA_BASE + DMAC);
+		return 1;
+	}
+	return 0;
+}
+
+static void ddrt_check_walk(struct ddrt *t, unsigned int addr,
+			    enum ddrt_pattern pat)
+{
+	unsigned int *p = (unsigned int *)addr;
+	unsigned int *end = p + t->region / 4;
+	unsigned int want, inv = pat == DDRT_WALK0 ? ~0 : 0;
+
+	invalidate_dcache_range(addr, addr + t->region);
+	for (; p < end; p++) {
+		want = ddrt_walk((unsigned int)p) ^ inv;
+		if (*p != want)
+			ddrt_report(t, (unsigned int)p, want, *p, pat);
+	}
+}
+
+static void ddrt_cpu_addr(struct ddrt *t, unsigned int addr)
+{
+	unsigned int *p, *end = (unsigned int *)(addr + t->region);
+
+	for (p = (unsigned int *)addr; p < end; p++)
+		*p = virt_to_phys(p);
+	flush_dcache_range(addr, addr + t->region);
+
+	for (p = (unsigned int *)addr; p < end; p++)
+		if (*p != virt_to_phys(p))
+			ddrt_report(t, (unsigned int)p, virt_to_phys(p), *p,
+				    DDRT_ADDR);
+	flush_dcache_range(addr, addr + t->region);
+}
+
+/*
+ * w(P); up (r P, w ~P); down (r ~P, w P); r(P). Every element goes
+ * through the DDR, the cache is written back between them.
+ */
+static void ddrt_cpu_movinv(struct ddrt *t, unsigned int addr)
+{
+	unsigned int *start = (unsigned int *)addr;
+	unsigned int *end = start + t->region / 4;
+	unsigned int *p;
+
+	for (p = start; p < end; p++)
+		*p = DDRT_MOVINV;
+	flush_dcache_range(addr, addr + t->region);
+
+	for (p = start; p < end; p++) {
+		if (*p != DDRT_MOVINV)
+			ddrt_report(t, (unsigned int)p, DDRT_MOVINV, *p,
+				    DDRT_MOVINV_P);
+		*p = ~DDRT_MOVINV;
+	}
+	flush_dcache_range(addr, addr + t->region);
+
+	for (p = end - 1; p >= start; p--) {
+		if (*p != ~DDRT_MOVINV)
+			ddrt_report(t, (unsigned int)p, ~DDRT_MOVINV, *p,
+				    DDRT_MOVINV_P);
+		*p = DDRT_MOVINV;
+	}
+	flush_dcache_range(addr, addr + t->region);
+
+	for (p = start; p < end; p++)
+		if (*p != DDRT_MOVINV)
+			ddrt_report(t, (unsigned int)p, DDRT_MOVINV, *p,
+				    DDRT_MOVINV_P);
+	flush_dcache_range(addr, addr + t->region);
+}
+
+static void ddrt_cpu(struct ddrt *t, unsigned int addr, enum ddrt_pattern pat)
+{
+	if (pat == DDRT_ADDR)
+		ddrt_cpu_addr(t, addr);
+	else
+		ddrt_cpu_movinv(t, addr);
+}
+
+/*
+ * One pass, the CPU region and the PDMA region of each pair alternate.
+ * Returns 1 on a PDMA error and -1 once the time budget is used up.
+ */
+static int ddrt_run_pass(struct ddrt *t, int pass)
+{
+	enum ddrt_pattern dma = ddrt_pass[pass].dma, cpu = ddrt_pass[pass].cpu;
+	unsigned int odd = pass & 1, pairs = DDRT_NR_REGIONS / 2;
+	unsigned int i, dma_addr;
+	int late;
+
+#define DDRT_REGION(i, n)	(t->base + (2 * (i) + (n)) * t->region)
+	ddrt_dma_fill(t, DDRT_REGION(0, !odd), dma);
+	for (i = 0; i < pairs; i++) {
+		dma_addr = DDRT_REGION(i, !odd);
+		ddrt_cpu(t, DDRT_REGION(i, odd), cpu);
+		if (ddrt_dma_wait())
+			return 1;
+		late = get_timer(t->start) > CONFIG_DDR_TEST_PARALLEL_MS;
+		if (!late && i + 1 < pairs)
+			ddrt_dma_fill(t, DDRT_REGION(i + 1, !odd), dma);
+		ddrt_check_walk(t, dma_addr, dma);
+		t->done += 2;
+		if (late)
+			return -1;
+	}
+#undef DDRT_REGION
+	return 0;
+}
+
+static int ddr_parallel_test(void)
+{
+	struct ddrt t;
+	unsigned int memsize, span, total, i;
+	ulong ms;
+	int pass, ret;
+
+#ifdef CONFIG_DDR_HOST_CC
+	t.row = DDR_ROW;
+	t.col = DDR_COL;
+	t.bank8 = DDR_BANK8;
+	t.dw32 = CONFIG_DDR_DW32;
+	memsize = (unsigned int)(DDR_CHIP_0_SIZE) + (unsigned int)(DDR_CHIP_1_SIZE);
+#else /* CONFIG_DDR_HOST_CC */
+	t.row = ddr_params_p->row;
+	t.col = ddr_params_p->col;
+	t.bank8 = ddr_params_p->bank8;
+	t.dw32 = ddr_params_p->dw32;
+	memsize = ddr_params_p->size.chip0 + ddr_params_p->size.chip1;
+#endif /* CONFIG_DDR_HOST_CC */
+	if (memsize > EMC_LOW_SDRAM_SPACE_SIZE)
+		memsize = EMC_LOW_SDRAM_SPACE_SIZE;
+
+	span = memsize - DDRT_SCRATCH;
+	if (span > CONFIG_DDR_TEST_PARALLEL_SIZE)
+		span = CONFIG_DDR_TEST_PARALLEL_SIZE;
+	/* a region is a whole number of 128 byte walking periods per desc */
+	t.region = (span / DDRT_NR_REGIONS) & ~(DDRT_NR_DESC * 128 - 1);
+	t.block = t.region / DDRT_NR_DESC;
+	if (!t.region || t.block + 4096 > DDRT_SCRATCH) {
+		printf("DDR parallel test: bad size 0x%x\n", span);
+		return 1;
+	}
+	t.base = KSEG0 + DDRT_SCRATCH;
+	t.desc = (struct jz_dma_desc *)KSEG1;
+	t.block_buf = (unsigned int *)(KSEG1 + 4096);
+	t.errors = 0;
+	t.done = 0;
+	for (i = 0; i < ARRAY_SIZE(t.remap); i++)
+		t.remap[i] = readl(DDRC_BASE + DDRC_REMAP(i / 4 + 1)) >>
+			(i % 4 * 8) & 0x1f;
+
+	writel(readl(CPM_BASE + CPM_CLKGR) & ~CPM_CLKGR_PDMA,
+	       CPM_BASE + CPM_CLKGR);
+	writel(0, PDMA_BASE + DMACP);
+	writel(DMAC_DMAE, PDMA_BASE + DMAC);
+
+	printf("DDR parallel test: 0x%x bytes from 0x%x, %d regions\n",
+	       t.region * DDRT_NR_REGIONS, DDRT_SCRATCH, DDRT_NR_REGIONS);
+	t.start = get_timer(0);
+	for (pass = 0; pass < ARRAY_SIZE(ddrt_pass); pass++) {
+		ret = ddrt_run_pass(&t, pass);
+		if (ret > 0)
+			t.errors++;
+		if (ret < 0)
+			break;
+	}
+	ms = get_timer(t.start);
+	writel(0, PDMA_BASE + DMAC);
+
+	/* a run cut short by CONFIG_DDR_TEST_PARALLEL_MS is not a pass */
+	total = ARRAY_SIZE(ddrt_pass) * DDRT_NR_REGIONS;
+	if (t.errors || t.done < total) {
+#ifdef CONFIG_BURNER
+		gd->arch.gi->ddr_test.cpu_dma_test.stat = 1;
+#endif
+		if (t.done < total)
+			printf("DDR parallel test INCOMPLETE: %d of %d regions "
+			       "(%d of %d passes) in %lu ms\n", t.done, total,
+			       t.done / DDRT_NR_REGIONS,
+			       ARRAY_SIZE(ddrt_pass), ms);
+		if (t.errors)
+			printf("DDR parallel test ERROR: %d bad words in "
+			       "%lu ms\n", t.errors, ms);
+		return 1;
+	}
+	printf("DDR parallel test OK in %lu ms\n", ms);
+	return 0;
+}
+#endif /* CONFIG_DDR_TEST_PARALLEL */
+
 #ifdef CONFIG_DDR_TEST
 void ddr_basic_tests(void)
 {
@@ -758,6 +1084,10 @@ void ddr_basic_tests(void)
 #endif
 #endif /* CONFIG_DDR_TEST_CPU_DMA */
 
+#ifdef CONFIG_DDR_TEST_PARALLEL
+	ddr_parallel_test();
+#endif
+
 #if 0
 #ifdef CONFIG_DDR_TEST_REMAP
 #ifdef CONFIG_BURNER
@@ -1,16 +1,179 @@
 #include <config.h>
 #include <common.h>
 #include <div64.h>
+#include <spl.h>
+#include <image.h>
 #include <asm/io.h>
+#include <asm/gpio.h>
 #include <asm/mipsregs.h>
 #include <asm/arch/ost.h>
+#ifdef CONFIG_SPL_LZO
+#include <linux/lzo.h>
+#endif
+#ifdef CONFIG_SPL_OS_BOOT_ENV
+#include <environment.h>
+#endif
 
+#ifdef CONFIG_SPL_BUILD
+/*
+ * Falcon mode is left for full U-Boot while the recovery key is held.
+ */
 int spl_start_uboot(void)
 {
-	printf("mach spl_start_uboot ? no\n");
+#ifdef CONFIG_SPL_OS_BOOT_GPIO
+	gpio_direction_input(CONFIG_SPL_OS_BOOT_GPIO);
+	if (gpio_get_value(CONFIG_SPL_OS_BOOT_GPIO) == CONFIG_SPL_OS_BOOT_GPIO_ENLEVEL) {
+		printf("spl: boot key held, starting u-boot\n");
+		return 1;
+	}
+#endif
 	return 0;
 }
 
+#ifdef CONFIG_SPL_OS_BOOT_ENV
+static char *os_bootargs;
+
+static env_t *spl_env_pick(env_t *env1, env_t *env2)
+{
+	int ok1 = crc32(0, env1->data, ENV_SIZE) == env1->crc;
+#ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
+	int ok2 = crc32(0, env2->data, ENV_SIZE) == env2->crc;
+
+	if (ok1 && ok2)
+		return env2->flags == ACTIVE_FLAG && env1->flags != ACTIVE_FLAG ?
+			env2 : env1;
+	if (ok2)
+		return env2;
+#endif
+	return ok1 ? env1 : NULL;
+}
+
+static char *spl_env_get(env_t *env, const char *name)
+{
+	char *p = (char *)env->data;
+	char *end = p + ENV_SIZE;
+	int len = strlen(name);
+
+	while (p < end && *p) {
+		if (!strncmp(p, name, len) && p[len] == '=')
+			return p + len + 1;
+		p += strlen(p) + 1;
+	}
+	return NULL;
+}
+
+/*
+ * The U-Boot environment has the last word: "spl_boot_os=0" disables
+ * falcon mode and "spl_bootargs" replaces the built-in kernel command
+ * line. The raw environment is read into the DDR just below the
+ * compressed image staging area.
+ */
+static int spl_env_start_uboot(spl_os_read_t read)
+{
+	env_t *env1, *env2 = NULL;
+	env_t *env;
+	char *s;
+
+	env1 = (env_t *)(CONFIG_SPL_OS_LOAD_ADDR - 2 * CONFIG_ENV_SIZE);
+	read(CONFIG_ENV_OFFSET, CONFIG_ENV_SIZE, env1);
+#ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
+	env2 = (env_t *)(CONFIG_SPL_OS_LOAD_ADDR - CONFIG_ENV_SIZE);
+	read(CONFIG_ENV_OFFSET_REDUND, CONFIG_ENV_SIZE, env2);
+#endif
+
+	env = spl_env_pick(env1, env2);
+	if (!env)
+		return 0;
+
+	s = spl_env_get(env, "spl_boot_os");
+	if (s && (*s == '0' || *s == 'n')) {
+		printf("spl: spl_boot_os=%s, starting u-boot\n", s);
+		return 1;
+	}
+
+	os_bootargs = spl_env_get(env, "spl_bootargs");
+	return 0;
+}
+
+void *spl_os_bootargs(void)
+{
+	if (os_bootargs)
+		return os_bootargs;
+	return (void *)CONFIG_SYS_SPL_ARGS_ADDR;
+}
+#endif
+
+/*
+ * Load a Linux uImage at @offs through @read. A plain image is read straight
+ * to its load address, an LZO compressed one is staged at
+ * CONFIG_SPL_OS_LOAD_ADDR first and unpacked to the load address.
+ * On failure the caller falls back to loading U-Boot.
+ */
+int spl_load_os_image(spl_os_read_t read, unsigned int offs)
+{
+	struct image_header *header = (struct image_header *)CONFIG_SYS_TEXT_BASE;
+	int ret = -1;
+
+#ifdef CONFIG_SPL_OS_BOOT_ENV
+	if (spl_env_start_uboot(read))
+		return -1;
+#endif
+
+	if (read(offs, sizeof(struct image_header), header))
+		goto out;
+	if (image_get_magic(header) != IH_MAGIC ||
+	    image_get_os(header) != IH_OS_LINUX)
+		goto out;
+
+	switch (image_get_comp(header)) {
+	case IH_COMP_NONE:
+		spl_parse_image_header(header);
+		if (read(offs, spl_image.size, (void *)spl_image.load_addr)) {
+			printf("spl: kernel read error\n");
+			goto out;
+		}
+		ret = 0;
+		break;
+#ifdef CONFIG_SPL_LZO
+	case IH_COMP_LZO: {
+		void *stage = (void *)CONFIG_SPL_OS_LOAD_ADDR;
+		ulong load = image_get_load(header);
+		ulong ep = image_get_ep(header);
+		size_t len;
+
+		/* the kernel is unpacked over the header, keep what is needed */
+		if (read(offs, image_get_image_size(header), stage)) {
+			printf("spl: kernel read error\n");
+			goto out;
+		}
+		if (lzop_decompress(stage + sizeof(struct image_header),
+				    image_get_data_size(header),
+				    (void *)load, &len) != LZO_E_OK) {
+			printf("spl: kernel lzo decompress error\n");
+			goto out;
+		}
+		spl_image.os = IH_OS_LINUX;
+		spl_image.load_addr = load;
+		spl_image.entry_point = ep;
+		spl_image.size = len;
+		ret = 0;
+		break;
+	}
+#endif
+	default:
+		printf("spl: unsupported kernel compression %d\n",
+		       image_get_comp(header));
+		break;
+	}
+
+out:
+	/* never let the u-boot path mistake this header for its own */
+	if (ret)
+		header->ih_magic = 0;
+	return ret;
+}
+#endif /* CONFIG_SPL_BUILD */
+
 void spl_board_prepare_for_linux(void)
 {
 #ifdef CONFIG_PALLADIUM
@@ -23,5 +186,6 @@ void spl_board_prepare_for_linux(void)
 
 int cleanup_before_linux (void)
 {
-	printf("mach cleanup_before_linux\n");
+	/* nothing to tear down, the caches are flushed by the caller */
+	return 0;
 }
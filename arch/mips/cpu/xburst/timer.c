@@ -55,7 +55,16 @@ int timer_init(void)
 	multiple = CONFIG_SYS_EXTAL / USEC_IN_1SEC / OST_DIV;
 #endif
 
+#if defined(CONFIG_BOOTSTAGE) || defined(CONFIG_SPL_BOOTSTAGE)
+	/*
+	 * Keep counting once the OST runs, so that the SPL and U-Boot marks
+	 * share a single timeline starting at the first timer_init().
+	 */
+	if (!(tcu_readl(TCU_TER) & TER_OSTEN))
+		reset_timer();
+#else
 	reset_timer();
+#endif
 	tcu_writel(OSTCSR_CNT_MD | OSTCSR_PRESCALE | OSTCSR_EXT_EN, TCU_OSTCSR);
 	tcu_writew(TER_OSTEN, TCU_TESR);
 
@@ -88,6 +97,15 @@ void __udelay(unsigned long usec)
 	while (get_timer64() < end);
 }
 
+#if defined(CONFIG_BOOTSTAGE) || defined(CONFIG_SPL_BOOTSTAGE)
+ulong timer_get_boot_us(void)
+{
+	if (!multiple)
+		return 0;
+	return lldiv(get_timer64(), multiple);
+}
+#endif
+
 unsigned long long get_ticks(void)
 {
 	return get_timer64();
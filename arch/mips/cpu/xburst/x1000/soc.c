@@ -81,6 +81,7 @@ void board_init_f(ulong dummy)
 
 	debug("Timer init\n");
 	timer_init();
+	bootstage_mark_name(BOOTSTAGE_ID_START_SPL, "spl");
 
 #ifndef CONFIG_FPGA
 #ifdef CONFIG_SPL_CORE_VOLTAGE
@@ -97,12 +98,14 @@ void board_init_f(ulong dummy)
 
 	debug("PLL init\n");
 	pll_init();
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_PLL_INIT, "pll_init");
 
 	debug("CLK init\n");
 	clk_init();
 
 	debug("SDRAM init\n");
 	sdram_init();
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_SDRAM_INIT, "sdram_init");
 
 #ifdef CONFIG_DDR_TEST
 	ddr_basic_tests();
@@ -0,0 +1,125 @@
+/*
+ * X1000 PDMA controller
+ *
+ * Copyright (c) 2013 Ingenic Semiconductor Co.,Ltd
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __JZ_DMA_H__
+#define __JZ_DMA_H__
+
+#include <asm/arch/base.h>
+
+#define JZ_DMA_NR_CHAN		8
+
+/* per channel registers, at PDMA_BASE + chan * 0x20 */
+#define CH_DSA			0x00	/* source address */
+#define CH_DTA			0x04	/* target address */
+#define CH_DTC			0x08	/* transfer count */
+#define CH_DRT			0x0c	/* request type */
+#define CH_DCS			0x10	/* control/status */
+#define CH_DCM			0x14	/* command */
+#define CH_DDA			0x18	/* descriptor address */
+#define CH_DSD			0x1c	/* stride */
+
+#define JZ_DMA_CH(chan)		(PDMA_BASE + (chan) * 0x20)
+
+/* global registers */
+#define DMAC			0x1000	/* control */
+#define DIRQP			0x1004	/* interrupt pending */
+#define DDR			0x1008	/* doorbell */
+#define DDRS			0x100c	/* doorbell set */
+#define DMACP			0x101c	/* channel programmable */
+
+#define DMAC_DMAE		(1 << 0)
+#define DMAC_AR			(1 << 2)
+#define DMAC_HLT		(1 << 3)
+
+#define DMAC_DRSR_RS_AUTO	0x08
+#define DMAC_DRSR_RS_SSI0_TX	0x16
+#define DMAC_DRSR_RS_SSI0_RX	0x17
+#define DMAC_DRSR_RS_MSC0_TX	0x1a
+#define DMAC_DRSR_RS_MSC0_RX	0x1b
+#define DMAC_DRSR_RS_MSC1_TX	0x1c
+#define DMAC_DRSR_RS_MSC1_RX	0x1d
+
+#define DMAC_DCCSR_NDES		(1 << 31)	/* no descriptor */
+#define DMAC_DCCSR_DES8		(1 << 30)	/* 8 word descriptors */
+#define DMAC_DCCSR_AR		(1 << 4)	/* address error */
+#define DMAC_DCCSR_TT		(1 << 3)	/* transfer terminated */
+#define DMAC_DCCSR_HLT		(1 << 2)
+#define DMAC_DCCSR_EN		(1 << 0)
+
+#define DMAC_DCMD_SAI		(1 << 23)
+#define DMAC_DCMD_DAI		(1 << 22)
+#define DMAC_DCMD_RDIL_IGN	(0 << 16)
+#define DMAC_DCMD_SWDH_32	(0 << 14)
+#define DMAC_DCMD_SWDH_8	(1 << 14)
+#define DMAC_DCMD_SWDH_16	(2 << 14)
+#define DMAC_DCMD_DWDH_32	(0 << 12)
+#define DMAC_DCMD_DWDH_8	(1 << 12)
+#define DMAC_DCMD_DWDH_16	(2 << 12)
+#define DMAC_DCMD_DS_32BIT	(0 << 8)
+#define DMAC_DCMD_DS_8BIT	(1 << 8)
+#define DMAC_DCMD_DS_16BIT	(2 << 8)
+#define DMAC_DCMD_DS_16BYTE	(3 << 8)
+#define DMAC_DCMD_DS_32BYTE	(4 << 8)
+#define DMAC_DCMD_DS_64BYTE	(5 << 8)
+#define DMAC_DCMD_DS_128BYTE	(6 << 8)
+#define DMAC_DCMD_DS_MASK	(7 << 8)
+#define DMAC_DCMD_TIE		(1 << 1)
+#define DMAC_DCMD_LINK		(1 << 0)
+
+/*
+ * Hardware descriptor. A chain has to sit in one 4KB page: the next
+ * descriptor is given by bits 11:4 of its address in dtc[31:24].
+ */
+struct jz_dma_desc {
+	u32 dcm;
+	u32 dsa;
+	u32 dta;
+	u32 dtc;
+	u32 sd;
+	u32 drt;
+	u32 reserved[2];
+};
+
+#define JZ_DMA_NR_DESC		16	/* per channel, 8 channels fill a page */
+
+#ifdef CONFIG_JZ_PDMA
+/* below this the cache maintenance costs more than the copy */
+#ifndef CONFIG_JZ_PDMA_THRESHOLD
+#define CONFIG_JZ_PDMA_THRESHOLD	(64 * 1024)
+#endif
+
+/* drivers/dma/jz_pdma.c */
+int jz_dma_request(void);
+void jz_dma_free(int chan);
+
+/*
+ * Append a transfer of @len bytes to the channel chain. Addresses are
+ * physical, @dcm carries the increment/width bits and @drt the request
+ * type. The caller keeps the caches coherent.
+ */
+int jz_dma_add(int chan, unsigned long dst, unsigned long src,
+	       unsigned int len, unsigned int dcm, unsigned int drt);
+int jz_dma_start(int chan);
+int jz_dma_wait(int chan, unsigned int timeout_ms);
+
+/* cache-coherent helpers, falling back to the CPU for small or odd sizes */
+void *dma_memcpy(void *dst, const void *src, size_t len);
+void *dma_memset(void *s, int c, size_t len);
+/* @s and @len word aligned, @val stored as is */
+void *dma_memset32(void *s, u32 val, size_t len);
+#endif
+
+#endif /* __JZ_DMA_H__ */
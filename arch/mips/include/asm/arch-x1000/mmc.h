@@ -154,6 +154,42 @@
 #define	MSC_IREG_END_CMD_RES		(1 << 2)
 #define	MSC_IREG_PRG_DONE		(1 << 1)
 #define	MSC_IREG_DATA_TRAN_DONE		(1 << 0)
+#define	MSC_IREG_DMA_DATA_DONE		(1 << 31)
+#define	MSC_IREG_DMAEND			(1 << 16)
+
+/* MSC DMA Control Register (MSC_DMAC) */
+
+#define	MSC_DMAC_MODE_SEL		(1 << 7)
+#define	MSC_DMAC_AOFST_BIT		5
+#define	MSC_DMAC_AOFST_MASK		(0x3 << MSC_DMAC_AOFST_BIT)
+#define	MSC_DMAC_ALIGNEN		(1 << 4)
+#define	MSC_DMAC_INCR_BIT		2
+#define	MSC_DMAC_INCR_MASK		(0x3 << MSC_DMAC_INCR_BIT)
+  #define MSC_DMAC_INCR_16		  (0x0 << MSC_DMAC_INCR_BIT)
+  #define MSC_DMAC_INCR_32		  (0x1 << MSC_DMAC_INCR_BIT)
+  #define MSC_DMAC_INCR_64		  (0x2 << MSC_DMAC_INCR_BIT)
+#define	MSC_DMAC_DMASEL			(1 << 1)
+#define	MSC_DMAC_DMAEN			(1 << 0)
+
+/* MSC DMA Command Register (MSC_DMACMD), also the descriptor dcmd word */
+
+#define	MSC_DMACMD_IDI_BIT		24
+#define	MSC_DMACMD_IDI_MASK		(0xff << MSC_DMACMD_IDI_BIT)
+#define	MSC_DMACMD_ID_BIT		16
+#define	MSC_DMACMD_ID_MASK		(0xff << MSC_DMACMD_ID_BIT)
+#define	MSC_DMACMD_OFFSET_BIT		9
+#define	MSC_DMACMD_OFFSET_MASK		(0x3 << MSC_DMACMD_OFFSET_BIT)
+#define	MSC_DMACMD_ALIGN_EN		(1 << 8)
+#define	MSC_DMACMD_ENDI			(1 << 1)
+#define	MSC_DMACMD_LINK			(1 << 0)
+
+/* MSC DMA descriptor, fetched by the controller from MSC_DMANDA */
+struct jz_msc_dma_desc {
+	volatile unsigned int nda;	/* physical address of next descriptor */
+	volatile unsigned int da;	/* physical address of data */
+	volatile unsigned int len;	/* transfer length in bytes */
+	volatile unsigned int dcmd;	/* MSC_DMACMD_* */
+};
 
 #define	LPM_DRV_SEL_SHF			30
 #define	LPM_DRV_SEL_MASK		(0x3 << LPM_DRV_SEL_SHF)
@@ -24,6 +24,7 @@
 
 #include <asm/arch/base.h>
 
+#define TCU_TER				0x10
 #define TCU_TESR			0x14
 #define TCU_OSTDR			0xe0
 #define TCU_OSTCNTL			0xe4
@@ -163,5 +163,33 @@ struct norflash_partitions {
 #define SFC_FIFO_LEN	(63)
 #define THRESHOLD	(31)
 
+/* below this the FIFO is faster than the cache maintenance of a DMA */
+#define SFC_DMA_MIN_LEN	(256)
+#define SFC_DMA_TIMEOUT	(3000)	/* ms */
+
+int sfc_xfer_data(unsigned char *cmd, unsigned int len, unsigned int addr,
+		unsigned addr_len, unsigned dummy_byte, void *buf, unsigned char dir);
+int sfc_send_cmd_poll(unsigned char *cmd, unsigned int len, unsigned int addr,
+		unsigned addr_len, void *buf, unsigned char poll_cmd,
+		unsigned int poll_addr, unsigned poll_addr_len);
+int sfc_nor_get_info(unsigned int *size, unsigned int *sector_size);
+int sfc_nor_write(unsigned int src_addr, unsigned int count,
+		  unsigned int dst_addr, unsigned int erase_en);
+int sfc_nor_erase(unsigned int src_addr, unsigned int count);
+void sfc_busy_hook(void);
+#ifdef CONFIG_SFC_NOR_SHADOW
+void *sfc_nor_map(unsigned int offset, unsigned int len);
+int sfc_nor_in_shadow(const void *buf);
+void sfc_nor_unmap(unsigned int offset, unsigned int len);
+#endif
+#ifdef CONFIG_JZ_SFC_DMA
+int sfc_nor_read_start(unsigned int src_addr, unsigned int count, void *buf);
+int sfc_nor_read_wait(void);
+#endif
+#ifdef CONFIG_SFC_NAND_CACHE
+void sfcnand_cache_stats(void);
+void sfcnand_cache_flush(void);
+#endif
+
 #endif
 
@@ -93,7 +93,16 @@
 #define CMD_ERASE_128K			0xd8
 #define CMD_R_CACHE				0x03	/* read from cache */
 #define CMD_FR_CACHE			0x0b	/* fast read from cache */
+#define CMD_DUAL_R_CACHE		0x3b	/* read from cache x2 */
+#define CMD_QUAD_R_CACHE		0x6b	/* read from cache x4 */
+#define CMD_R_CACHE_SEQ			0x31	/* read page cache sequential */
+#define CMD_R_CACHE_END			0x3f	/* read page cache last */
 #define CMD_GET_FEATURE			0x0f
+#define CMD_SET_FEATURE			0x1f
+
+#define FEATURE_REG_B0			0xb0
+#define FEATURE_ECC_EN			(1 << 4)
+#define FEATURE_QE			(1 << 0)
 
 #define FEATURE_ADDR			0xc0
 
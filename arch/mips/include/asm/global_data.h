@@ -40,6 +40,9 @@ struct arch_global_data {
 #ifdef CONFIG_CPU_XBURST
 	struct global_info *gi;
 #endif
+#ifdef CONFIG_SFC_NOR_SHADOW
+	unsigned long sfc_nor_shadow;	/* DRAM shadow of the SFC NOR */
+#endif
 };
 
 #include <asm-generic/global_data.h>
@@ -20,6 +20,14 @@
 extern char __bss_start[];
 extern ulong __bss_end;
 
+#ifdef CONFIG_SPL_OS_BOOT
+/* falcon mode, see arch/mips/cpu/xburst/os_boot.c */
+/* returns 0, or nonzero if the flash read failed */
+typedef int (*spl_os_read_t)(unsigned int offs, unsigned int len, void *dst);
+int spl_load_os_image(spl_os_read_t read, unsigned int offs);
+void *spl_os_bootargs(void);
+#endif
+
 static inline u32 spl_boot_device(void)
 {
 #ifdef CONFIG_SPL_RAM_DEVICE
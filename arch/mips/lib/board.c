@@ -163,6 +163,7 @@ void board_init_f(ulong bootflag)
 		if ((*init_fnc_ptr)() != 0)
 			hang();
 	}
+	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_F, "board_init_f");
 
 	/*
 	 * Now that we have DRAM mapped and working, we can
@@ -191,6 +192,14 @@ void board_init_f(ulong bootflag)
 #endif /* CONFIG_FB_ADDR */
 #endif /* CONFIG_LCD */
 
+#ifdef CONFIG_SFC_NOR_SHADOW
+	/* reserve the SFC NOR shadow, out of reach of loads like U-Boot */
+	addr -= CONFIG_SFC_NOR_SHADOW_SIZE;
+	printf("Reserving %dk for SFC NOR shadow at: %08lx\n",
+			CONFIG_SFC_NOR_SHADOW_SIZE >> 10, addr);
+	gd->arch.sfc_nor_shadow = addr;
+#endif
+
 	/* Reserve memory for U-Boot code, data & bss
 	 * round down to next 16 kB limit
 	 */
@@ -292,6 +301,14 @@ void board_init_r(gd_t *id, ulong dest_addr)
 	mem_malloc_init(CONFIG_SYS_MONITOR_BASE + gd->reloc_off -
 			TOTAL_MALLOC_LEN, TOTAL_MALLOC_LEN);
 
+	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_R, "board_init_r");
+#ifdef CONFIG_BOOTSTAGE_STASH
+	/* pick up the SPL marks before the images overwrite them */
+	bootstage_unstash((void *)CONFIG_BOOTSTAGE_STASH,
+			  CONFIG_BOOTSTAGE_STASH_SIZE);
+#endif
+	bootstage_relocate();
+
 #ifndef CONFIG_SYS_NO_FLASH
 	/* configure available FLASH banks */
 	size = flash_init();
@@ -49,6 +49,9 @@ static void boot_prep_linux(bootm_headers_t *images)
 	char env_buf[12];
 	char *cp;
 
+#ifdef CONFIG_BOOTSTAGE_STASH
+	commandline = bootstage_stash_cmdline(commandline);
+#endif
 	linux_params_init(UNCACHED_SDRAM(gd->bd->bi_boot_params), commandline);
 
 #ifdef CONFIG_MEMSIZE_IN_BYTES
@@ -94,6 +97,15 @@ static void boot_jump_linux(bootm_headers_t *images)
 		(ulong) theKernel);
 
 	bootstage_mark(BOOTSTAGE_ID_RUN_OS);
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
+#ifdef CONFIG_BOOTSTAGE_STASH
+	/* the kernel finds it through "bootstage_stash=" on its cmdline */
+	bootstage_stash((void *)CONFIG_BOOTSTAGE_STASH,
+			CONFIG_BOOTSTAGE_STASH_SIZE);
+#endif
+#ifdef CONFIG_BOOTSTAGE_REPORT
+	bootstage_report();
+#endif
 
 	/* we assume that the kernel is in place */
 	printf("\nStarting kernel ...\n\n");
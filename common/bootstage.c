@@ -35,30 +35,13 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
-struct bootstage_record {
-	ulong time_us;
-	uint32_t start_us;
-	const char *name;
-	int flags;		/* see enum bootstage_flags */
-	enum bootstage_id id;
-};
-
 static struct bootstage_record record[BOOTSTAGE_ID_COUNT] = { {1} };
 static int next_id = BOOTSTAGE_ID_USER;
 
 enum {
-	BOOTSTAGE_VERSION	= 0,
-	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
 };
 
-struct bootstage_hdr {
-	uint32_t version;	/* BOOTSTAGE_VERSION */
-	uint32_t count;		/* Number of records */
-	uint32_t size;		/* Total data size (non-zero if valid) */
-	uint32_t magic;		/* Unused */
-};
-
 int bootstage_relocate(void)
 {
 	int i;
@@ -471,3 +454,14 @@ int bootstage_unstash(void *base, int size)
 
 	return 0;
 }
+
+#ifdef CONFIG_BOOTSTAGE_STASH
+char *bootstage_stash_cmdline(const char *commandline)
+{
+	static char buf[CONFIG_SYS_CBSIZE];
+
+	snprintf(buf, sizeof(buf), "%s bootstage_stash=0x%08x",
+		 commandline ? commandline : "", CONFIG_BOOTSTAGE_STASH);
+	return buf;
+}
+#endif
@@ -38,6 +38,9 @@
 #include <asm/byteorder.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#ifdef CONFIG_JZ_PDMA
+#include <asm/arch/dma.h>
+#endif
 
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
@@ -72,6 +75,24 @@ DECLARE_GLOBAL_DATA_PTR;
 extern void bz_internal_error(int);
 #endif
 
+#ifdef CONFIG_JZ_PDMA
+/* memmove_wd() on the PDMA, for buffers that do not overlap */
+static void dma_memcpy_wd(void *to, const void *from, size_t len,
+			  unsigned long chunksz)
+{
+	size_t tail;
+
+	while (len > 0) {
+		tail = min(len, (size_t)chunksz);
+		WATCHDOG_RESET();
+		dma_memcpy(to, from, tail);
+		to += tail;
+		from += tail;
+		len -= tail;
+	}
+}
+#endif
+
 #if defined(CONFIG_CMD_IMI)
 static int image_info(unsigned long addr);
 #endif
@@ -393,6 +414,13 @@ static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 			no_overlap = 1;
 		} else {
 			printf("   Loading %s ... ", type_name);
+#ifdef CONFIG_JZ_PDMA
+			if (load + image_len <= image_start ||
+			    image_start + image_len <= load)
+				dma_memcpy_wd(load_buf, image_buf, image_len,
+					      CHUNKSZ);
+			else
+#endif
 			memmove_wd(load_buf, image_buf, image_len, CHUNKSZ);
 		}
 		*load_end = load + image_len;
@@ -31,10 +31,18 @@
 #include <config.h>
 #include <mmc.h>
 #include <boot_img.h>
+#include <malloc.h>
 #include <asm/arch/sfc.h>
-
-extern void flush_cache_all(void);
-
+#include <asm/unaligned.h>
+#ifdef CONFIG_LZO
+#include <linux/lzo.h>
+#endif
+#ifdef CONFIG_GZIP
+#include <u-boot/zlib.h>
+#endif
+#ifdef CONFIG_JZ_PDMA
+#include <asm/arch/dma.h>
+#endif
 
 /*boot.img has been in memory already. just call init_boot_linux() and jump to kernel.*/
 static void bootx_jump_kernel(unsigned long mem_address)
@@ -49,7 +57,19 @@ static void bootx_jump_kernel(unsigned long mem_address)
 	printf("Prepare kernel parameters ...\n");
 	param_addr = (u32 *)CONFIG_PARAM_BASE;
 	param_addr[0] = 0;
+#ifdef CONFIG_BOOTSTAGE_STASH
+	param_addr[1] = (u32)bootstage_stash_cmdline(CONFIG_BOOTX_BOOTARGS);
+#else
 	param_addr[1] = CONFIG_BOOTX_BOOTARGS;
+#endif
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
+#ifdef CONFIG_BOOTSTAGE_STASH
+	bootstage_stash((void *)CONFIG_BOOTSTAGE_STASH,
+			CONFIG_BOOTSTAGE_STASH_SIZE);
+#endif
+#ifdef CONFIG_BOOTSTAGE_REPORT
+	bootstage_report();
+#endif
 	flush_cache_all();
 	image_entry(2, (char **)param_addr, NULL);
 
@@ -63,6 +83,235 @@ static int mem_bootx(unsigned int mem_address)
 	bootx_jump_kernel(mem_address);
 	return 0;
 }
+#if defined(CONFIG_JZ_SFC) && defined(CONFIG_JZ_SFC_DMA)
+/*
+ * Compressed uImages are not staged in DRAM: the SFC DMA fills the next
+ * chunk of a window buffer while the CPU decompresses what has already
+ * arrived straight to the image load address.
+ */
+#define BOOTX_STREAM
+#define BOOTX_CHUNK	(64 * 1024)
+#define BOOTX_WINDOW	(1024 * 1024)
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000	/* same limit as bootm */
+#endif
+
+struct bootx_stream {
+	unsigned char *win;
+	unsigned int rd;	/* win[rd, wr) is read but not decompressed yet */
+	unsigned int wr;
+	unsigned int eof;	/* the whole image is in the window */
+	unsigned char *dst;	/* next output byte */
+	unsigned char *dst_end;	/* load address + CONFIG_SYS_BOOTM_LEN */
+	int started;
+	int done;
+#ifdef CONFIG_GZIP
+	z_stream zs;
+#endif
+};
+
+#ifdef CONFIG_LZO
+/* decompress every complete lzop block in the window */
+static int bootx_lzo_consume(struct bootx_stream *st)
+{
+	const unsigned char *src = st->win + st->rd;
+	const unsigned char *end = st->win + st->wr;
+	u32 dlen, slen;
+	size_t len;
+
+	if (!st->started) {
+		/* the lzop header is a few hundred bytes at most */
+		if (end - src < 512 && !st->eof)
+			return 0;
+		src = lzop_parse_header(src);
+		if (!src)
+			return -1;
+		st->started = 1;
+	}
+
+	while (end - src >= 4) {
+		dlen = get_unaligned_be32(src);
+		if (dlen == 0) {
+			st->done = 1;
+			src += 4;
+			break;
+		}
+		/* uncompressed size, compressed size, checksum, data */
+		if (end - src < 12)
+			break;
+		slen = get_unaligned_be32(src + 4);
+		if (slen == 0 || slen > dlen || slen > BOOTX_WINDOW - BOOTX_CHUNK)
+			return -1;
+		if (end - src < 12 + slen)
+			break;
+		if (dlen > st->dst_end - st->dst) {
+			puts("Image too large: increase CONFIG_SYS_BOOTM_LEN\n");
+			return -1;
+		}
+
+		if (slen == dlen) {
+			/* stored block */
+#ifdef CONFIG_JZ_PDMA
+			dma_memcpy(st->dst, src + 12, dlen);
+#else
+			memcpy(st->dst, src + 12, dlen);
+#endif
+		} else {
+			len = dlen;
+			if (lzo1x_decompress_safe(src + 12, slen, st->dst, &len) != LZO_E_OK ||
+			    len != dlen)
+				return -1;
+		}
+		st->dst += dlen;
+		src += 12 + slen;
+	}
+
+	st->rd = src - st->win;
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_GZIP
+/* feed everything in the window to inflate */
+static int bootx_gzip_consume(struct bootx_stream *st)
+{
+	int r;
+
+	if (!st->started) {
+		if (st->wr - st->rd < 512 && !st->eof)
+			return 0;
+		r = gzip_parse_header(st->win + st->rd, st->wr - st->rd);
+		if (r < 0)
+			return -1;
+		st->rd += r;
+
+		st->zs.zalloc = gzalloc;
+		st->zs.zfree = gzfree;
+		if (inflateInit2(&st->zs, -MAX_WBITS) != Z_OK)
+			return -1;
+		st->zs.next_out = st->dst;
+		st->zs.avail_out = st->dst_end - st->dst;
+		st->started = 1;
+	}
+
+	st->zs.next_in = st->win + st->rd;
+	st->zs.avail_in = st->wr - st->rd;
+	r = inflate(&st->zs, Z_SYNC_FLUSH);
+	st->rd = st->wr - st->zs.avail_in;
+	st->dst = st->zs.next_out;
+
+	if (r == Z_STREAM_END) {
+		st->done = 1;
+		inflateEnd(&st->zs);
+	} else if (!st->zs.avail_out) {
+		puts("Image too large: increase CONFIG_SYS_BOOTM_LEN\n");
+		inflateEnd(&st->zs);
+		return -1;
+	} else if (r != Z_OK && r != Z_BUF_ERROR) {
+		printf("Error: inflate() returned %d\n", r);
+		inflateEnd(&st->zs);
+		return -1;
+	}
+	return 0;
+}
+#endif
+
+/*
+ * Returns 1 when the image is not compressed in a way the stream loader
+ * knows, 0 once the kernel sits at its load address, -1 on error.
+ * The output is bounded by CONFIG_SYS_BOOTM_LEN and by u-boot itself;
+ * nothing is staged at the bootx mem_address on this path.
+ */
+static int bootx_stream_load(unsigned int sfc_addr, const struct image_header *header)
+{
+	int (*consume)(struct bootx_stream *st);
+	struct bootx_stream st;
+	unsigned int left = image_get_data_size(header);
+	unsigned int flash = sfc_addr + sizeof(struct image_header);
+	unsigned int len, shift, rd;
+	unsigned long sp;
+	int ret = -1;
+
+	switch (image_get_comp(header)) {
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+		consume = bootx_lzo_consume;
+		break;
+#endif
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		consume = bootx_gzip_consume;
+		break;
+#endif
+	default:
+		return 1;
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.win = memalign(ARCH_DMA_MINALIGN, BOOTX_WINDOW);
+	if (!st.win)
+		return -1;
+	st.dst = (unsigned char *)image_get_load(header);
+	st.dst_end = st.dst + CONFIG_SYS_BOOTM_LEN;
+
+	/* keep the output below the stack, heap and relocated u-boot */
+	__asm__ __volatile__("move %0, $sp" : "=r"(sp));
+	sp -= 4096;
+	if ((unsigned long)st.dst >= sp) {
+		printf("bootx: load address 0x%x is inside u-boot\n",
+		       image_get_load(header));
+		goto out;
+	}
+	if ((unsigned long)st.dst_end > sp)
+		st.dst_end = (unsigned char *)sp;
+
+	while (!st.done) {
+		/* slide the undecoded tail down, keeping wr cache line aligned */
+		if (BOOTX_WINDOW - st.wr < BOOTX_CHUNK && st.rd >= ARCH_DMA_MINALIGN) {
+			shift = st.rd & ~(ARCH_DMA_MINALIGN - 1);
+			memmove(st.win, st.win + shift, st.wr - shift);
+			st.rd -= shift;
+			st.wr -= shift;
+		}
+
+		len = 0;
+		if (left && BOOTX_WINDOW - st.wr >= BOOTX_CHUNK) {
+			len = min(left, (unsigned int)BOOTX_CHUNK);
+			if (sfc_nor_read_start(flash, ALIGN(len, ARCH_DMA_MINALIGN),
+					       st.win + st.wr))
+				goto out;
+		}
+
+		/* decompress what is already there while the next chunk arrives */
+		rd = st.rd;
+		if (consume(&st)) {
+			printf("bootx: decompress error at 0x%x\n", flash);
+			sfc_nor_read_wait();
+			goto out;
+		}
+
+		if (len) {
+			if (sfc_nor_read_wait())
+				goto out;
+			st.wr += len;
+			flash += len;
+			left -= len;
+			st.eof = !left;
+		} else if (st.rd == rd && !st.done) {
+			printf("bootx: truncated or corrupt image\n");
+			goto out;
+		}
+	}
+
+	printf("bootx: %d bytes unpacked to 0x%x\n",
+	       st.dst - (unsigned char *)image_get_load(header), image_get_load(header));
+	ret = 0;
+out:
+	free(st.win);
+	return ret;
+}
+#endif
+
 #ifdef CONFIG_JZ_SFC
 static void sfc_boot(unsigned int mem_address,unsigned int sfc_addr)
 {
@@ -93,16 +342,38 @@ static void sfc_boot(unsigned int mem_address,unsigned int sfc_addr)
 		}
 	}
 #endif
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_START, "kernel_read");
 	header_size = sizeof(struct image_header);
 	sfc_nor_read(sfc_addr, header_size, CONFIG_SYS_TEXT_BASE);
 	header = (struct image_header *)(CONFIG_SYS_TEXT_BASE);
 
+#ifdef BOOTX_STREAM
+	/*
+	 * A compressed uImage is unpacked to the load address in its header
+	 * and entered at its entry point, mem_address only applies to the
+	 * plain xImage below.
+	 */
+	if (image_get_magic(header) == IH_MAGIC) {
+		struct image_header hdr = *header;	/* the kernel may land on it */
+		int ret = bootx_stream_load(sfc_addr, &hdr);
+
+		if (ret < 0)
+			return;
+		if (ret == 0) {
+			bootstage_mark_name(BOOTSTAGE_KERNELREAD_STOP, "kernel_loaded");
+			bootx_jump_kernel(image_get_ep(&hdr));
+			return;
+		}
+	}
+#endif
+
 	entry_point = image_get_load(header);
 	/* Load including the header */
 	load_addr = entry_point - header_size;
 	size = image_get_data_size(header) + header_size;
 
 	sfc_nor_read(sfc_addr, size, load_addr);
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_STOP, "kernel_loaded");
 
 	bootx_jump_kernel(mem_address);
 }
@@ -147,6 +418,8 @@ static char bootx_help_text[] =
         "- boot Android system....\n"
         "\tThe argument [way] means the way of booting boot.img.[way]='mem'/'sfc'.\n"
         "\tThe argument [mem_address] means the start position of xImage in memory.\n"
+        "\tWith 'sfc' a compressed uImage is unpacked to its own load address\n"
+        "\tand entered at its own entry point, [mem_address] is not used.\n"
         "\tThe argument [offset] means the position of xImage in sfc-nor.\n"
         "";
 #endif
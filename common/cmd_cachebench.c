@@ -0,0 +1,137 @@
+/*
+ * cachebench - per call cost of the D-cache maintenance ops
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+
+#define BENCH_MAX	(256 * 1024)
+
+static const ulong bench_size[] = {
+	32, 256, 1024, 4096, 8192, 16384, 65536, BENCH_MAX,
+};
+
+enum bench_op {
+	OP_NONE,
+	OP_FLUSH,
+	OP_FLUSH_NOSYNC,
+	OP_WRITEBACK,
+	OP_INVALIDATE,
+	OP_FLUSH_ALL,
+};
+
+static void bench_call(enum bench_op op, ulong start, ulong stop)
+{
+	switch (op) {
+	case OP_NONE:
+		break;
+	case OP_FLUSH:
+		flush_dcache_range(start, stop);
+		break;
+	case OP_FLUSH_NOSYNC:
+		flush_dcache_range_nosync(start, stop);
+		break;
+	case OP_WRITEBACK:
+		writeback_dcache_range(start, stop);
+		break;
+	case OP_INVALIDATE:
+		invalidate_dcache_range(start, stop);
+		break;
+	case OP_FLUSH_ALL:
+		flush_dcache_all();
+		break;
+	}
+}
+
+/* ns per call, the buffer is made dirty before each call if @dirty */
+static ulong bench_run(enum bench_op op, u8 *buf, ulong size, int dirty,
+		       ulong loops)
+{
+	ulong start, us, i;
+
+	flush_dcache_all();
+	start = timer_get_boot_us();
+	for (i = 0; i < loops; i++) {
+		if (dirty)
+			memset(buf, i, size);
+		bench_call(op, (ulong)buf, (ulong)buf + size);
+	}
+	us = timer_get_boot_us() - start;
+
+	return us * 1000 / loops;
+}
+
+static ulong bench_cost(enum bench_op op, u8 *buf, ulong size, int dirty,
+			ulong loops, ulong base)
+{
+	ulong ns = bench_run(op, buf, size, dirty, loops);
+
+	return ns > base ? ns - base : 0;
+}
+
+/*
+ * The dirty columns take the cost of the memset that dirties the range
+ * off, what is left is the writeback of every line plus the op itself.
+ */
+static int do_cachebench(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	u8 *buf;
+	ulong size, loops, base;
+	int i;
+
+	buf = memalign(CONFIG_SYS_CACHELINE_SIZE, BENCH_MAX);
+	if (!buf) {
+		printf("no memory for the %d KB buffer\n", BENCH_MAX >> 10);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("  bytes  clean flush   dirty flush  dirty nosync"
+	       "  dirty wback  invalidate   (ns per call)\n");
+	for (i = 0; i < ARRAY_SIZE(bench_size); i++) {
+		size = bench_size[i];
+		loops = min(1024UL, max(16UL, (1UL << 20) / size));
+
+		base = bench_run(OP_NONE, buf, size, 1, loops);
+		printf("%7lu", size);
+		printf(" %12lu", bench_cost(OP_FLUSH, buf, size, 0, loops, 0));
+		printf(" %13lu",
+		       bench_cost(OP_FLUSH, buf, size, 1, loops, base));
+		printf(" %13lu",
+		       bench_cost(OP_FLUSH_NOSYNC, buf, size, 1, loops, base));
+		printf(" %12lu",
+		       bench_cost(OP_WRITEBACK, buf, size, 1, loops, base));
+		printf(" %11lu\n",
+		       bench_cost(OP_INVALIDATE, buf, size, 0, loops, 0));
+	}
+
+	printf("flush_dcache_all: %lu ns clean, %lu ns dirty\n",
+	       bench_cost(OP_FLUSH_ALL, buf, 0, 0, 1024, 0),
+	       bench_cost(OP_FLUSH_ALL, buf, CONFIG_SYS_DCACHE_SIZE, 1, 256,
+			  bench_run(OP_NONE, buf, CONFIG_SYS_DCACHE_SIZE,
+				    1, 256)));
+	printf("ranges from %d KB up use the index walk\n",
+	       CONFIG_SYS_DCACHE_SIZE >> 10);
+
+	free(buf);
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	cachebench, 1, 0, do_cachebench,
+	"time the D-cache maintenance ops",
+	"\n"
+	"    - print the cost per call of flush, writeback and invalidate\n"
+	"      on clean and dirty ranges from one line to 256 KB"
+);
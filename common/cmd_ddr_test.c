@@ -5,6 +5,10 @@
 #include <asm/string.h>
 #include <asm/arch/clk.h>
 #include <asm/arch/base.h>
+#include <div64.h>
+#ifdef CONFIG_JZ_PDMA
+#include <asm/arch/dma.h>
+#endif
 
 #define WRITE_FLAG 0
 #define READ_FLAG 1
@@ -12,14 +16,19 @@
 #define CACHE_FLAG 0
 #define UNCACHE_FLAG 1
 #define REG32(addr) *(volatile unsigned int*)(addr)
-static void ddr_count_start()
+
+/* bytes moved per size class in "ddr_wr c" */
+#define CLASS_BYTES	(32 * 1024 * 1024)
+#define CLASS_MIN	1024
+#define CLASS_MAX	(2 * 1024 * 1024)
+
+static void ddr_count_enable(void)
 {
 #ifdef CONFIG_X1000
 	unsigned int val;
 	val = REG32(0xb00000d0);
 	val |= (1<<6);
 	REG32(0xb00000d0) = val;
-	printf("ddr_drcg = 0x%x\n", REG32(0xb00000d0));
 #endif
 	REG32((DDRC_BASE + 0xd4)) = 0;
 	REG32((DDRC_BASE + 0xd8)) = 0;
@@ -27,18 +36,28 @@ static void ddr_count_start()
 	REG32((DDRC_BASE + 0xe4)) = 3;
 }
 
+static void ddr_count_read(unsigned int *total, unsigned int *valid,
+			   unsigned int *idle)
+{
+	REG32((DDRC_BASE + 0xe4)) = 2;
+	*total = REG32((DDRC_BASE + 0xd4));
+	*valid = REG32((DDRC_BASE + 0xd8));
+	*idle = REG32((DDRC_BASE + 0xdc));
+}
+
+static void ddr_count_start()
+{
+	ddr_count_enable();
+#ifdef CONFIG_X1000
+	printf("ddr_drcg = 0x%x\n", REG32(0xb00000d0));
+#endif
+}
+
 static void ddr_count_stop()
 {
 	unsigned int i,j,k;
 
-	i = 0;
-	j = 0;
-	k = 0;
-
-	REG32((DDRC_BASE + 0xe4)) = 2;
-	i = REG32((DDRC_BASE + 0xd4));
-	j = REG32((DDRC_BASE + 0xd8));
-	k = REG32((DDRC_BASE + 0xdc));
+	ddr_count_read(&i, &j, &k);
 	printf("total_cycle = %d,valid_cycle = %d\n", i, j);
 	printf("rate      = %%%d\n", j * 100 / i);
 	printf("idle_rate = %%%d\n\n", k * 100 / i);
@@ -99,6 +118,59 @@ static int err_print(unsigned int num)
 	printf("ddr_wr w/r/p [size] [k/m] [times] [cache/uncache]\n");
 	return CMD_RET_USAGE;
 }
+
+static unsigned int ddr_rate(unsigned long long bytes, unsigned int ms)
+{
+	if (!ms)
+		ms = 1;
+	bytes *= 1000;
+	do_div(bytes, ms);
+	return bytes >> 20;
+}
+
+/*
+ * memset/read/memcpy throughput from cache sized blocks up to blocks
+ * well past the L2, so tuning of the string routines shows per class.
+ */
+static int ddr_wr_classes(void)
+{
+	char *src, *dst;
+	unsigned int size, times, ms_w, ms_r, ms_p, start;
+
+	src = malloc(CLASS_MAX);
+	dst = malloc(CLASS_MAX);
+	if (!src || !dst) {
+		printf("malloc faile\n");
+		free(src);
+		free(dst);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("    size  memset MB/s  read MB/s  memcpy MB/s\n");
+	for (size = CLASS_MIN; size <= CLASS_MAX; size <<= 1) {
+		times = CLASS_BYTES / size;
+
+		start = get_timer(0);
+		ddr_write((unsigned int *)src, size, times);
+		ms_w = get_timer(start);
+
+		start = get_timer(0);
+		ddr_read((unsigned int *)src, size, times);
+		ms_r = get_timer(start);
+
+		start = get_timer(0);
+		ddr_memcpy(src, dst, size, times);
+		ms_p = get_timer(start);
+
+		printf("%6dK  %11d  %9d  %11d\n", size >> 10,
+		       ddr_rate(CLASS_BYTES, ms_w), ddr_rate(CLASS_BYTES, ms_r),
+		       ddr_rate(CLASS_BYTES, ms_p));
+	}
+
+	free(src);
+	free(dst);
+	return CMD_RET_SUCCESS;
+}
 static int ddr_wr_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	unsigned int wr_flag = READ_FLAG;
@@ -112,6 +184,8 @@ static int ddr_wr_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]
 
 	if (argc < 2)
 		return err_print(0);
+	if (!strcmp(argv[1], "c"))
+		return ddr_wr_classes();
 
 	printf("current ddr test:\n");
 	printf("ddr_wr ");
@@ -201,6 +275,8 @@ static int ddr_wr_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]
 	end = get_timer(0);
 	printf("current %d us\n",end);
 	printf("spend %d us\n",end - start);
+	printf("%d MB/s\n", ddr_rate((unsigned long long)size * times,
+				     end - start));
 
 	free(src_addr);
 	if(wr_flag == MEMCPY_FLAG)
@@ -211,4 +287,298 @@ static int ddr_wr_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]
 U_BOOT_CMD(ddr_wr, 5, 2, ddr_wr_test,
 	"Ingenic ddr read write test",
 	"ddr_wr w/r/p [size] [k/m] [times] [cache/uncache]\n"
+	"ddr_wr c - memset/read/memcpy MB/s for each size class\n"
+);
+
+/*
+ * ddrbench: sequential, strided, latency and bank conflict tests on one
+ * buffer, cached or uncached, with the CPU or the PDMA doing the bulk
+ * moves. Bandwidth is in MB/s, latency in ns per access, and "busy" is
+ * the share of DDRC cycles doing transfers. The summary line lands in
+ * ddrbench_<cache|uncache>_<cpu|dma> for comparing DDR parameter sets.
+ */
+#define BENCH_SIZE	(4 * 1024 * 1024)
+#define BENCH_BYTES	(64 * 1024 * 1024)	/* per bandwidth test */
+#define BENCH_STRIDE	4096			/* one access per DDR page */
+#define BENCH_STEPS	(1024 * 1024)		/* per latency test */
+#define BENCH_LINE	32
+
+struct ddrbench {
+	char *buf;
+	char *dst;
+	unsigned int size;
+	int dma;
+	unsigned int start;
+	char summary[256];
+	int len;
+};
+
+static void bench_start(struct ddrbench *b)
+{
+	ddr_count_enable();
+	b->start = get_timer(0);
+}
+
+/* elapsed ms, and the DDRC busy percentage for the run */
+static unsigned int bench_stop(struct ddrbench *b, unsigned int *busy)
+{
+	unsigned int ms = get_timer(b->start);
+	unsigned int total, valid, idle;
+
+	ddr_count_read(&total, &valid, &idle);
+	*busy = total ? (unsigned int)(((unsigned long long)valid * 100) /
+				       total) : 0;
+	return ms;
+}
+
+static unsigned int bench_ns(unsigned int ms, unsigned int steps)
+{
+	unsigned long long ns = (unsigned long long)ms * 1000000;
+
+	do_div(ns, steps);
+	return ns;
+}
+
+static void bench_report(struct ddrbench *b, const char *key,
+			 const char *what, unsigned int val, const char *unit,
+			 unsigned int busy)
+{
+	printf("%-22s %6d %-4s busy %3d%%\n", what, val, unit, busy);
+	if (b->len < sizeof(b->summary))
+		b->len += snprintf(b->summary + b->len,
+				   sizeof(b->summary) - b->len,
+				   ",%s=%d", key, val);
+}
+
+static void bench_seq(struct ddrbench *b)
+{
+	unsigned int times = BENCH_BYTES / b->size;
+	unsigned int i, ms, busy;
+
+	if (!b->dma) {
+		bench_start(b);
+		ddr_read((unsigned int *)b->buf, b->size, times);
+		ms = bench_stop(b, &busy);
+		bench_report(b, "rd", "sequential read", ddr_rate(BENCH_BYTES, ms),
+			     "MB/s", busy);
+	}
+
+	bench_start(b);
+	for (i = 0; i < times; i++) {
+#ifdef CONFIG_JZ_PDMA
+		if (b->dma)
+			dma_memset(b->buf, i, b->size);
+		else
+#endif
+			memset(b->buf, i, b->size);
+	}
+	ms = bench_stop(b, &busy);
+	bench_report(b, "wr", "sequential write", ddr_rate(BENCH_BYTES, ms),
+		     "MB/s", busy);
+
+	bench_start(b);
+	for (i = 0; i < times; i++) {
+#ifdef CONFIG_JZ_PDMA
+		if (b->dma)
+			dma_memcpy(b->dst, b->buf, b->size);
+		else
+#endif
+			memcpy(b->dst, b->buf, b->size);
+	}
+	ms = bench_stop(b, &busy);
+	bench_report(b, "cp", "sequential copy", ddr_rate(BENCH_BYTES, ms),
+		     "MB/s", busy);
+}
+
+/* one word per cache line, hopping a DDR page each time */
+static void bench_stride(struct ddrbench *b)
+{
+	volatile unsigned int *p;
+	unsigned int off, pos, ms, busy, lines = 0, rounds;
+	unsigned int i;
+
+	rounds = BENCH_BYTES / b->size;
+
+	bench_start(b);
+	for (i = 0; i < rounds; i++) {
+		for (off = 0; off < BENCH_STRIDE; off += BENCH_LINE) {
+			for (pos = off; pos < b->size; pos += BENCH_STRIDE) {
+				p = (volatile unsigned int *)(b->buf + pos);
+				(void)*p;
+			}
+		}
+	}
+	ms = bench_stop(b, &busy);
+	lines = rounds * (b->size / BENCH_LINE);
+	bench_report(b, "srd", "strided read",
+		     ddr_rate((unsigned long long)lines * BENCH_LINE, ms),
+		     "MB/s", busy);
+
+	bench_start(b);
+	for (i = 0; i < rounds; i++) {
+		for (off = 0; off < BENCH_STRIDE; off += BENCH_LINE) {
+			for (pos = off; pos < b->size; pos += BENCH_STRIDE) {
+				p = (volatile unsigned int *)(b->buf + pos);
+				*p = pos;
+			}
+		}
+	}
+	ms = bench_stop(b, &busy);
+	bench_report(b, "swr", "strided write",
+		     ddr_rate((unsigned long long)lines * BENCH_LINE, ms),
+		     "MB/s", busy);
+}
+
+/*
+ * Dependent loads through a random cycle of cache lines, so neither the
+ * caches nor open DDR pages help.
+ */
+static void bench_latency(struct ddrbench *b)
+{
+	unsigned int lines = b->size / BENCH_LINE;
+	unsigned int *order = (unsigned int *)b->dst;
+	unsigned int seed = 0x2545f491;
+	unsigned int i, j, tmp, ms, busy;
+	void * volatile *p;
+
+	for (i = 0; i < lines; i++)
+		order[i] = i;
+	for (i = lines - 1; i > 0; i--) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		j = seed % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (i = 0; i < lines; i++)
+		*(void **)(b->buf + order[i] * BENCH_LINE) =
+			b->buf + order[(i + 1) % lines] * BENCH_LINE;
+	if (((unsigned long)b->buf & 0xe0000000) == 0x80000000)
+		flush_dcache_range((ulong)b->buf, (ulong)b->buf + b->size);
+
+	p = (void * volatile *)(b->buf + order[0] * BENCH_LINE);
+	bench_start(b);
+	for (i = 0; i < BENCH_STEPS; i++)
+		p = *p;
+	ms = bench_stop(b, &busy);
+	bench_report(b, "lat", "random read latency", bench_ns(ms, BENCH_STEPS),
+		     "ns", busy);
+}
+
+/*
+ * Ping-pong between two addresses at growing distances. Once the
+ * distance lands both in the same bank on different rows every access
+ * pays a precharge and activate; the slowest distance is reported.
+ */
+static void bench_bank(struct ddrbench *b)
+{
+	volatile unsigned int *a, *c;
+	unsigned int dist, i, ms, busy, ns;
+	unsigned int worst = 0, worst_dist = 0;
+	char what[32];
+
+	for (dist = 1024; dist <= b->size / 2; dist <<= 1) {
+		/* uncached, or every access after the first would hit */
+		a = (volatile unsigned int *)((unsigned long)b->buf | 0xa0000000);
+		c = (volatile unsigned int *)((unsigned long)b->buf + dist);
+		c = (volatile unsigned int *)((unsigned long)c | 0xa0000000);
+
+		bench_start(b);
+		for (i = 0; i < BENCH_STEPS / 2; i++) {
+			(void)*a;
+			(void)*c;
+		}
+		ms = bench_stop(b, &busy);
+		ns = bench_ns(ms, BENCH_STEPS);
+		sprintf(what, "bank ping-pong %dK", dist >> 10);
+		printf("%-22s %6d %-4s busy %3d%%\n", what, ns, "ns", busy);
+		if (ns > worst) {
+			worst = ns;
+			worst_dist = dist;
+		}
+	}
+	if (b->len < sizeof(b->summary))
+		b->len += snprintf(b->summary + b->len,
+				   sizeof(b->summary) - b->len,
+				   ",bank=%d@%dK", worst, worst_dist >> 10);
+}
+
+static int do_ddrbench(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct ddrbench b;
+	char *buf, *dst;
+	int uncache = 0;
+	int i;
+	char name[32];
+
+	memset(&b, 0, sizeof(b));
+	b.size = BENCH_SIZE;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "cache"))
+			uncache = 0;
+		else if (!strcmp(argv[i], "uncache"))
+			uncache = 1;
+		else if (!strcmp(argv[i], "cpu"))
+			b.dma = 0;
+		else if (!strcmp(argv[i], "dma"))
+			b.dma = 1;
+		else
+			b.size = simple_strtoul(argv[i], NULL, 0) << 10;
+	}
+#ifndef CONFIG_JZ_PDMA
+	if (b.dma) {
+		printf("PDMA support not built in\n");
+		return CMD_RET_FAILURE;
+	}
+#endif
+	if (b.size < 2 * BENCH_STRIDE || b.size > BENCH_BYTES ||
+	    b.size & (BENCH_STRIDE - 1))
+		return CMD_RET_USAGE;
+
+	buf = memalign(BENCH_STRIDE, b.size);
+	dst = memalign(BENCH_STRIDE, b.size);
+	if (!buf || !dst) {
+		printf("malloc faile\n");
+		free(buf);
+		free(dst);
+		return CMD_RET_FAILURE;
+	}
+	/* nothing of ours may be left dirty above an uncached alias */
+	flush_dcache_range((ulong)buf, (ulong)buf + b.size);
+	flush_dcache_range((ulong)dst, (ulong)dst + b.size);
+	b.buf = uncache ? (char *)((unsigned long)buf | 0xa0000000) : buf;
+	b.dst = uncache ? (char *)((unsigned long)dst | 0xa0000000) : dst;
+
+	printf("ddrbench: %dK %s %s, ddr %d MHz\n", b.size >> 10,
+	       uncache ? "uncached" : "cached", b.dma ? "pdma" : "cpu",
+	       CONFIG_SYS_MEM_FREQ / 1000000);
+	b.len = snprintf(b.summary, sizeof(b.summary), "freq=%d,size=%dK",
+			 CONFIG_SYS_MEM_FREQ / 1000000, b.size >> 10);
+
+	bench_seq(&b);
+	if (!b.dma) {
+		bench_stride(&b);
+		bench_latency(&b);
+		bench_bank(&b);
+	}
+
+	sprintf(name, "ddrbench_%s_%s", uncache ? "uncache" : "cache",
+		b.dma ? "dma" : "cpu");
+	setenv(name, b.summary);
+	printf("%s=%s\n", name, b.summary);
+
+	free(buf);
+	free(dst);
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(ddrbench, 4, 0, do_ddrbench,
+	"DDR bandwidth and latency benchmark",
+	"[cache|uncache] [cpu|dma] [size in KB]\n"
+	"    - sequential and strided read/write/copy in MB/s, random read\n"
+	"      latency and bank conflict ping-pong in ns. The summary is\n"
+	"      stored in ddrbench_<cache|uncache>_<cpu|dma>"
 );
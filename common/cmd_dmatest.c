@@ -0,0 +1,111 @@
+/*
+ * dmatest - compare CPU and PDMA memcpy/memset throughput
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <asm/arch/dma.h>
+
+static void dmatest_report(const char *what, ulong bytes, ulong ms)
+{
+	if (!ms)
+		ms = 1;
+	printf("%-12s %8lu KB in %5lu ms, %4lu MB/s\n", what, bytes >> 10,
+	       ms, (bytes / ms) * 1000 >> 20);
+}
+
+static int dmatest_check(const u8 *a, const u8 *b, ulong len)
+{
+	ulong i;
+
+	for (i = 0; i < len; i++) {
+		if (a[i] != b[i]) {
+			printf("mismatch at 0x%08lx: %02x != %02x\n",
+			       (ulong)&b[i], b[i], a[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int dmatest_fill_check(const u8 *p, u8 c, ulong len)
+{
+	ulong i;
+
+	for (i = 0; i < len; i++) {
+		if (p[i] != c) {
+			printf("mismatch at 0x%08lx: %02x != %02x\n",
+			       (ulong)&p[i], p[i], c);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * The CPU runs are timed up to the flush so that both sides pay for
+ * getting the data into the DDR.
+ */
+static int do_dmatest(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	u8 *src, *dst;
+	ulong len, start, i;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	src = (u8 *)simple_strtoul(argv[1], NULL, 16);
+	len = simple_strtoul(argv[2], NULL, 16);
+	dst = src + len;
+	if (len < CONFIG_JZ_PDMA_THRESHOLD) {
+		printf("size below the DMA threshold 0x%x\n",
+		       CONFIG_JZ_PDMA_THRESHOLD);
+		return CMD_RET_FAILURE;
+	}
+
+	for (i = 0; i < len; i++)
+		src[i] = i ^ (i >> 8);
+
+	start = get_timer(0);
+	memcpy(dst, src, len);
+	flush_dcache_range((ulong)dst, (ulong)dst + len);
+	dmatest_report("cpu memcpy", len, get_timer(start));
+
+	memset(dst, 0, len);
+	start = get_timer(0);
+	dma_memcpy(dst, src, len);
+	dmatest_report("dma memcpy", len, get_timer(start));
+	if (dmatest_check(src, dst, len))
+		return CMD_RET_FAILURE;
+
+	start = get_timer(0);
+	memset(dst, 0x5a, len);
+	flush_dcache_range((ulong)dst, (ulong)dst + len);
+	dmatest_report("cpu memset", len, get_timer(start));
+
+	start = get_timer(0);
+	dma_memset(dst, 0xa5, len);
+	dmatest_report("dma memset", len, get_timer(start));
+	if (dmatest_fill_check(dst, 0xa5, len))
+		return CMD_RET_FAILURE;
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	dmatest, 3, 0, do_dmatest,
+	"compare CPU and PDMA memcpy/memset speed",
+	"addr size\n"
+	"    - copy size bytes from addr to addr+size and fill them, once\n"
+	"      with the CPU and once with the PDMA, and verify the result"
+);
@@ -95,6 +95,10 @@
 #include <linux/ctype.h>
 #include <cramfs/cramfs_fs.h>
 
+#if defined(CONFIG_JZ_SFC_NOR)
+#include <asm/arch/sfc.h>
+#endif
+
 #if defined(CONFIG_CMD_NAND)
 #include <linux/mtd/nand.h>
 #include <nand.h>
@@ -177,6 +181,14 @@ static int mtd_device_validate(u8 type, u8 num, u32 *size)
 
 		printf("no such FLASH device: %s%d (valid range 0 ... %d\n",
 				MTD_DEV_TYPE(type), num, CONFIG_SYS_MAX_FLASH_BANKS - 1);
+#elif defined(CONFIG_JZ_SFC_NOR)
+		u32 sector_size;
+
+		if (num == 0 && sfc_nor_get_info(size, &sector_size) == 0)
+			return 0;
+
+		printf("no such FLASH device: %s%d (SFC NOR is %s0)\n",
+				MTD_DEV_TYPE(type), num, MTD_DEV_TYPE(type));
 #else
 		printf("support for FLASH devices not present\n");
 #endif
@@ -300,6 +312,12 @@ static inline u32 get_part_sector_size_nor(struct mtdids *id, struct part_info *
 	}
 
 	return sector_size;
+#elif defined(CONFIG_JZ_SFC_NOR)
+	u32 size, sector_size;
+
+	if (sfc_nor_get_info(&size, &sector_size))
+		return 0;
+	return sector_size;
 #else
 	BUG();
 	return 0;
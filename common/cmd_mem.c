@@ -36,6 +36,9 @@
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#ifdef CONFIG_JZ_PDMA
+#include <asm/arch/dma.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -447,6 +450,15 @@ static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	bytes = size * count;
 	buf = map_sysmem(dest, bytes);
 	src = map_sysmem(addr, bytes);
+#ifdef CONFIG_JZ_PDMA
+	if (bytes >= CONFIG_JZ_PDMA_THRESHOLD &&
+	    (dest + bytes <= addr || addr + bytes <= dest)) {
+		dma_memcpy(buf, src, bytes);
+		unmap_sysmem(buf);
+		unmap_sysmem(src);
+		return 0;
+	}
+#endif
 	while (count-- > 0) {
 		if (size == 4)
 			*((ulong *)buf) = *((ulong  *)src);
@@ -1120,6 +1132,40 @@ mod_mem(cmd_tbl_t *cmdtp, int incrflag, int flag, int argc, char * const argv[])
 
 #ifdef CONFIG_CMD_CRC32
 
+/*
+ * crc32 -b address count: time the byte table CRC against the one
+ * crc32() really uses and check that both agree.
+ */
+static int do_mem_crc_bench(int argc, char * const argv[])
+{
+	const unsigned char *buf;
+	ulong addr, count, start, byte_ms, ms;
+	uint32_t crc_byte, crc;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[0], NULL, 16);
+	count = simple_strtoul(argv[1], NULL, 16);
+	buf = map_sysmem(addr, count);
+
+	start = get_timer(0);
+	crc_byte = crc32_bytewise(0xffffffff, buf, count);
+	byte_ms = max(get_timer(start), 1UL);
+
+	start = get_timer(0);
+	crc = crc32_no_comp(0xffffffff, buf, count);
+	ms = max(get_timer(start), 1UL);
+	unmap_sysmem(buf);
+
+	printf("crc32 0x%lx bytes: byte table %lu KB/s, crc32() %lu KB/s\n",
+	       count, count / byte_ms, count / ms);
+	if (crc != crc_byte) {
+		printf("CRC mismatch: %08x != %08x\n", crc, crc_byte);
+		return 1;
+	}
+	return 0;
+}
+
 static int do_mem_crc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	int flags = 0;
@@ -1131,6 +1177,8 @@ static int do_mem_crc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	av = argv + 1;
 	ac = argc - 1;
+	if (strcmp(*av, "-b") == 0)
+		return do_mem_crc_bench(ac - 1, av + 1);
 #ifdef CONFIG_HASH_VERIFY
 	if (strcmp(*av, "-v") == 0) {
 		flags |= HASH_FLAG_VERIFY;
@@ -1190,7 +1238,8 @@ U_BOOT_CMD(
 U_BOOT_CMD(
 	crc32,	4,	1,	do_mem_crc,
 	"checksum calculation",
-	"address count [addr]\n    - compute CRC32 checksum [save at addr]"
+	"address count [addr]\n    - compute CRC32 checksum [save at addr]\n"
+	"-b address count\n    - benchmark the CRC32 implementation"
 );
 
 #else	/* CONFIG_CRC32_VERIFY */
@@ -1199,7 +1248,8 @@ U_BOOT_CMD(
 	crc32,	5,	1,	do_mem_crc,
 	"checksum calculation",
 	"address count [addr]\n    - compute CRC32 checksum [save at addr]\n"
-	"-v address count crc\n    - verify crc of memory area"
+	"-v address count crc\n    - verify crc of memory area\n"
+	"-b address count\n    - benchmark the CRC32 implementation"
 );
 
 #endif	/* CONFIG_CRC32_VERIFY */
@@ -3,7 +3,113 @@
 #include <asm/io.h>
 #include <asm/arch/sfc.h>
 
-extern void sfc_nor_load(unsigned int src_addr, unsigned int count,unsigned int dst_addr);
+extern int sfc_nor_load(unsigned int src_addr, unsigned int count,unsigned int dst_addr);
+
+#ifdef CONFIG_JZ_SFC_DMA
+extern int sfc_dma_enable;
+
+static unsigned long sfc_nor_read_speed(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
+{
+	ulong start, ms;
+
+	start = get_timer(0);
+	sfc_nor_read(src_addr,count,dst_addr);
+	ms = get_timer(start);
+	if (ms == 0)
+		ms = 1;
+
+	return count / ms;	/* bytes per ms == KB/s */
+}
+
+static int do_sfcnor_speed(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
+{
+	int dma_enable = sfc_dma_enable;
+	unsigned long cpu_kbs, dma_kbs;
+
+	sfc_dma_enable = 0;
+	cpu_kbs = sfc_nor_read_speed(src_addr,count,dst_addr);
+	sfc_dma_enable = 1;
+	dma_kbs = sfc_nor_read_speed(src_addr,count,dst_addr);
+	sfc_dma_enable = dma_enable;
+
+	printf("sfcnor read 0x%x bytes: cpu %lu KB/s, dma %lu KB/s\n",
+			count, cpu_kbs, dma_kbs);
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SFC_NOR_SHADOW
+/* bring the range into the DRAM shadow, bootm/iminfo/imls then work on it */
+static int do_sfcnor_map(unsigned int src_addr, unsigned int count)
+{
+	void *addr;
+
+	addr = sfc_nor_map(src_addr, count);
+	if (!addr) {
+		printf("sfcnor map 0x%x size 0x%x failed, the shadow covers 0x0 - 0x%x\n",
+				src_addr, count, CONFIG_SFC_NOR_SHADOW_SIZE);
+		return CMD_RET_FAILURE;
+	}
+
+	load_addr = (ulong)addr;
+	setenv_addr("fileaddr", addr);
+	setenv_hex("filesize", count);
+	printf("sfcnor 0x%x mapped at %p\n", src_addr, addr);
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+#define SFC_NOR_PAGE_SIZE	256
+
+/* wspeed erases what it is given, keep it off the boot loader and env */
+#ifdef CONFIG_ENV_IS_IN_SFC
+#define SFC_NOR_BOOT_END	(CONFIG_ENV_OFFSET + CONFIG_ENV_SIZE)
+#else
+#define SFC_NOR_BOOT_END	(CONFIG_SPL_PAD_TO + CONFIG_SYS_MONITOR_LEN)
+#endif
+
+extern int sfc_auto_poll;
+
+static unsigned long sfc_nor_write_speed(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
+{
+	ulong start, ms;
+
+	sfc_nor_erase(src_addr,count);
+	start = get_timer(0);
+	sfc_nor_write(src_addr,count,dst_addr,0);
+	ms = get_timer(start);
+	if (ms == 0)
+		ms = 1;
+
+	return count / SFC_NOR_PAGE_SIZE * 1000 / ms;	/* pages per second */
+}
+
+static int do_sfcnor_wspeed(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
+{
+	int auto_poll = sfc_auto_poll;
+	unsigned long sw_pps, hw_pps;
+
+	if (src_addr < SFC_NOR_BOOT_END) {
+		printf("sfcnor wspeed: 0x%x is below 0x%x, u-boot and its env "
+		       "live there, give a scratch range\n",
+		       src_addr, SFC_NOR_BOOT_END);
+		return CMD_RET_FAILURE;
+	}
+	printf("sfcnor wspeed: erasing and writing 0x%x - 0x%x twice\n",
+	       src_addr, src_addr + count);
+
+	sfc_auto_poll = 0;
+	sw_pps = sfc_nor_write_speed(src_addr,count,dst_addr);
+	sfc_auto_poll = 1;
+	hw_pps = sfc_nor_write_speed(src_addr,count,dst_addr);
+	sfc_auto_poll = auto_poll;
+
+	printf("sfcnor write 0x%x bytes: software poll %lu pages/s, auto poll %lu pages/s\n",
+			count, sw_pps, hw_pps);
+	return 0;
+}
+#endif
 
 static int do_sfcnor(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -17,7 +123,9 @@ static int do_sfcnor(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		count = simple_strtoul(argv[3],NULL,16);
 		dst_addr = simple_strtoul(argv[4],NULL,16);
 		printf("sfcnor read Image from 0x%x to  0x%x size is 0x%x ...\n",src_addr,dst_addr,count);
+		bootstage_start(BOOTSTAGE_ID_ACCUM_SFC_READ, "sfcnor_read");
 		sfc_nor_read(src_addr,count,dst_addr);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_SFC_READ);
 		printf("sfcnor read ok!\n");
 		return 0;
 	}else if(!strcmp(argv[1],"write")){
@@ -31,6 +139,30 @@ static int do_sfcnor(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		printf("sfcnor write ok!\n");
 		return 0;
 
+#ifdef CONFIG_JZ_SFC_DMA
+	}else if(!strcmp(argv[1],"speed")){
+		if(argc < 5)
+			return CMD_RET_USAGE;
+		src_addr = simple_strtoul(argv[2],NULL,16);
+		count = simple_strtoul(argv[3],NULL,16);
+		dst_addr = simple_strtoul(argv[4],NULL,16);
+		return do_sfcnor_speed(src_addr,count,dst_addr);
+#endif
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+	}else if(!strcmp(argv[1],"wspeed")){
+		if(argc < 5)
+			return CMD_RET_USAGE;
+		src_addr = simple_strtoul(argv[2],NULL,16);
+		count = simple_strtoul(argv[3],NULL,16);
+		dst_addr = simple_strtoul(argv[4],NULL,16);
+		return do_sfcnor_wspeed(src_addr,count,dst_addr);
+#endif
+#ifdef CONFIG_SFC_NOR_SHADOW
+	}else if(!strcmp(argv[1],"map")){
+		src_addr = simple_strtoul(argv[2],NULL,16);
+		count = simple_strtoul(argv[3],NULL,16);
+		return do_sfcnor_map(src_addr,count);
+#endif
 	}else if(!strcmp(argv[1],"erase")){
 
 		src_addr = simple_strtoul(argv[2],NULL,16);
@@ -52,4 +184,14 @@ U_BOOT_CMD(
 	"sfcnor read   [src:nor flash addr] [bytes:0x..] [dst:ddr address]\n"
 	"sfcnor write  [src:nor flash addr] [bytes:0x..] [dst:der address] [force erase:1, nor erase:0]\n"
 	"sfcnor erase  [src:nor flash addr] [bytes:0x..]\n "
+#ifdef CONFIG_JZ_SFC_DMA
+	"sfcnor speed  [src:nor flash addr] [bytes:0x..] [dst:ddr address] - compare cpu and dma read\n "
+#endif
+#ifdef CONFIG_SFC_NOR_SHADOW
+	"sfcnor map    [src:nor flash addr] [bytes:0x..] - read through the dram shadow, sets fileaddr\n "
+#endif
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+	"sfcnor wspeed [src:nor flash addr] [bytes:0x..] [dst:ddr address] - erase and program, compare status polling\n"
+	"              DESTROYS the flash range, which must be scratch space above u-boot and env\n "
+#endif
 );
@@ -9,6 +9,7 @@
 #include <common.h>
 #include <command.h>
 #include <nand.h>
+#include <asm/arch/sfc.h>
 #define X_COMMAND_LENGTH 128
 
 int do_sfcnand(cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
@@ -20,6 +21,17 @@ int do_sfcnand(cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
 
 	cmd = argv[1];
 
+#ifdef CONFIG_SFC_NAND_CACHE
+	if(argc == 3 && !strcmp(cmd,"cache")){
+		if(!strcmp(argv[2],"stats"))
+			sfcnand_cache_stats();
+		else if(!strcmp(argv[2],"flush"))
+			sfcnand_cache_flush();
+		else
+			return CMD_RET_USAGE;
+		return CMD_RET_SUCCESS;
+	}
+#endif
 	if(argc != 5)
 	{
 		printf("ERROR: argv error,please check the param of cmd !!!\n");
@@ -42,6 +54,10 @@ int do_sfcnand(cmd_tbl_t * cmdtp, int flag, int argc, char *argv[])
 U_BOOT_CMD(sfcnand, 5, 1, do_sfcnand,
 		"sfcnand    - SFC_NAND sub-system\n",
 		"sfcnand read from(offs) size dst_addr\n"
+#ifdef CONFIG_SFC_NAND_CACHE
+		"sfcnand cache stats - page cache hit/miss counters\n"
+		"sfcnand cache flush - drop every cached page\n"
+#endif
 		);
 void sfc_nand_init(void)
 {
@@ -49,7 +65,11 @@ void sfc_nand_init(void)
 	struct mtd_info *mtd;
 	mtd = &nand_info[0];
 
+#ifdef CONFIG_SPI_QUAD
+	jz_sfc_nand_init(1,NULL);
+#else
 	jz_sfc_nand_init(0,NULL);
+#endif
 
 	chip =mtd->priv;
 	chip->scan_bbt(mtd);
@@ -627,6 +627,18 @@ static int do_ubi(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		return ret;
 	}
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	if (strcmp(argv[1], "fastmap") == 0) {
+		int err = ubi_update_fastmap(ubi);
+
+		if (err) {
+			printf("Cannot write the fastmap, error %d\n", err);
+			return 1;
+		}
+		return 0;
+	}
+#endif
+
 	if (strncmp(argv[1], "read", 4) == 0) {
 		size = 0;
 
@@ -672,6 +684,10 @@ U_BOOT_CMD(
 		" - Read volume to address with size\n"
 	"ubi remove[vol] volume"
 		" - Remove volume\n"
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	"ubi fastmap"
+		" - Write a fastmap for faster attaching\n"
+#endif
 	"[Legends]\n"
 	" volume: character name\n"
 	" size: specified in bytes\n"
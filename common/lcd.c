@@ -460,6 +460,11 @@ int drv_lcd_init(void)
 /*----------------------------------------------------------------------*/
 void lcd_clear_black(void)
 {
+#ifdef CONFIG_JZ_LCD_V13
+	int line_length;
+
+	fb_clear(lcd_base, lcd_get_size(&line_length));
+#else
 	unsigned int i;
 	int *lcdbase_p = (int *) gd->fb_base;
         int *p = malloc(panel_info.vl_col * panel_info.vl_row * 4);
@@ -470,6 +475,7 @@ void lcd_clear_black(void)
         fb_fill(p, lcd_base, panel_info.vl_col * panel_info.vl_row * 4);
         lcd_sync();
         free(p);
+#endif
 #if 0
 	int *lcdbase_p = (int *) gd->fb_base;
 	for (i = 0; i < lcd_line_length * panel_info.vl_row / 4; i++) {
@@ -1200,12 +1206,23 @@ int lcd_display_bitmap(ulong bmp_image, int x, int y)
 #ifdef CONFIG_CMD_LOGO_RLE
 int  lcd_display_rle(unsigned short *src_buf)
 {
+#ifdef CONFIG_JZ_LCD_V13
+	int line_length;
+#endif
+
 	if(src_buf == NULL )
 		return -1;
 	lcd_is_enabled = 0;
+#ifdef CONFIG_JZ_LCD_V13
+	/* decode straight into the panel's framebuffer, then send it */
+	fb_clear(lcd_base, lcd_get_size(&line_length));
+	rle_plot(src_buf, lcd_base);
+	fb_flush(lcd_base, lcd_get_size(&line_length));
+#else
 	lcd_clear_black();
 	rle_plot(src_buf, lcd_base);
 	lcd_sync();
+#endif
 	return 0;
 }
 
@@ -79,6 +79,17 @@ __weak void spl_board_prepare_for_linux(void)
 	/* Nothing to do! */
 }
 
+#ifdef CONFIG_SPL_OS_BOOT
+/*
+ * Weak default for the kernel argument handed over by jump_to_image_linux(),
+ * boards may take it from their environment instead.
+ */
+__weak void *spl_os_bootargs(void)
+{
+	return (void *)CONFIG_SYS_SPL_ARGS_ADDR;
+}
+#endif
+
 void spl_parse_image_header(const struct image_header *header)
 {
 	u32 header_size = sizeof(struct image_header);
@@ -245,6 +256,11 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 		hang();
 	}
 
+	bootstage_mark_name(BOOTSTAGE_ID_END_SPL, "end_spl");
+#ifdef CONFIG_SPL_BOOTSTAGE
+	bootstage_stash((void *)CONFIG_BOOTSTAGE_STASH, CONFIG_BOOTSTAGE_STASH_SIZE);
+#endif
+
 	switch (spl_image.os) {
 	case IH_OS_U_BOOT:
 		debug("Jumping to U-Boot\n");
@@ -253,7 +269,7 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 	case IH_OS_LINUX:
 		debug("Jumping to Linux\n");
 		spl_board_prepare_for_linux();
-		jump_to_image_linux((void *)CONFIG_SYS_SPL_ARGS_ADDR);
+		jump_to_image_linux(spl_os_bootargs());
 #endif
 	default:
 		debug("Unsupported OS image.. Jumping nevertheless..\n");
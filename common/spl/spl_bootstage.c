@@ -0,0 +1,71 @@
+/*
+ * SPL side of bootstage: a handful of timestamped marks, written to the
+ * stash area in the format bootstage_unstash() expects so that U-Boot can
+ * report the whole cold-boot timeline.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+
+#ifndef CONFIG_SPL_BOOTSTAGE_COUNT
+#define CONFIG_SPL_BOOTSTAGE_COUNT	8
+#endif
+
+/* marks are taken before the bss is cleared, keep them in .data */
+static struct bootstage_record record[CONFIG_SPL_BOOTSTAGE_COUNT]
+	__attribute__ ((section(".data")));
+static int count __attribute__ ((section(".data")));
+
+ulong bootstage_mark_name(enum bootstage_id id, const char *name)
+{
+	ulong now = timer_get_boot_us();
+	struct bootstage_record *rec;
+
+	if (count < CONFIG_SPL_BOOTSTAGE_COUNT) {
+		rec = &record[count++];
+		rec->time_us = now;
+		rec->start_us = 0;
+		rec->name = name ? name : "spl";
+		rec->flags = 0;
+		rec->id = id;
+	}
+	return now;
+}
+
+int bootstage_stash(void *base, int size)
+{
+	struct bootstage_hdr *hdr = base;
+	char *ptr = (char *)(hdr + 1);
+	char *end = (char *)base + size;
+	int i, len;
+
+	if (ptr + count * sizeof(record[0]) > end)
+		return -1;
+
+	hdr->version = BOOTSTAGE_VERSION;
+	hdr->count = count;
+	hdr->magic = BOOTSTAGE_MAGIC;
+	memcpy(ptr, record, count * sizeof(record[0]));
+	ptr += count * sizeof(record[0]);
+
+	for (i = 0; i < count; i++) {
+		len = strlen(record[i].name) + 1;
+		if (ptr + len > end)
+			return -1;
+		memcpy(ptr, record[i].name, len);
+		ptr += len;
+	}
+
+	hdr->size = ptr - (char *)base;
+	flush_dcache_range((ulong)base, ALIGN((ulong)ptr, CONFIG_SYS_CACHELINE_SIZE));
+	return 0;
+}
@@ -16,10 +16,16 @@
 #define msc_debug(fmt, args...) do { }while(0)
 #endif
 
+/* card clock once the card accepted high-speed timing */
+#ifndef CONFIG_SPL_JZMMC_HS_RATE
+#define CONFIG_SPL_JZMMC_HS_RATE	50000000
+#endif
+
 /* global variables */
 static uint32_t io_base = MSC0_BASE;
 static int bus_width = 0;
 static int highcap = 0;
+static int highspeed = 0;
 
 
 static uint32_t msc_readl(uint32_t off)
@@ -132,8 +138,6 @@ static int mmc_block_read(u32 start, u32 blkcnt, u32 *dst)
 
 	nob = blkcnt;
 
-	mmc_cmd(MMC_CMD_SET_BLOCKLEN, 0x200, 0x1, MSC_CMDAT_RESPONSE_R1);
-
 	msc_writel(MSC_BLKLEN, 0x200);
 	msc_writel(MSC_NOB, blkcnt);
 
@@ -180,6 +184,36 @@ err:
 }
 
 
+/*
+ * Single block read for the small register blocks (EXT_CSD, SD switch
+ * status), the card must already be in transfer state.
+ */
+static int mmc_read_data(u16 cmd, u32 arg, u32 *dst, u32 len)
+{
+	u32 stat, cnt = len / 4;
+	int timeout = 0xffff;
+
+	msc_writel(MSC_BLKLEN, len);
+	msc_writel(MSC_NOB, 1);
+	mmc_cmd(cmd, arg, 0x9 | bus_width << 9, MSC_CMDAT_RESPONSE_R1);
+
+	while (cnt) {
+		stat = msc_readl(MSC_STAT);
+		if (stat & (MSC_STAT_TIME_OUT_READ | MSC_STAT_CRC_READ_ERROR))
+			return -1;
+		if (stat & MSC_STAT_DATA_FIFO_EMPTY)
+			continue;
+		*dst++ = msc_readl(MSC_RXFIFO);
+		cnt--;
+	}
+
+	while (!(msc_readl(MSC_STAT) & MSC_STAT_DATA_TRAN_DONE) && timeout--)
+		mdelay(1);
+	msc_writel(MSC_IREG, MSC_IREG_DATA_TRAN_DONE);
+
+	return 0;
+}
+
 int sd_found(void)
 {
 	u8 *resp;
@@ -230,6 +264,20 @@ int sd_found(void)
 #endif
 	resp = mmc_cmd(6, bus_width, 0x1 | (bus_width << 9), MSC_CMDAT_RESPONSE_R1);
 
+#ifndef CONFIG_FPGA
+	{
+		/* switch function status, scratch space is the U-Boot load area */
+		u8 *status = (u8 *)CONFIG_SYS_TEXT_BASE;
+
+		/* mode 1, access mode group 1 to function 1 (high speed) */
+		if (!mmc_read_data(SD_CMD_SWITCH_FUNC,
+				   (SD_SWITCH_SWITCH << 31) | 0xfffff1,
+				   (u32 *)status, 64) &&
+		    (status[16] & 0xf) == 1)
+			highspeed = 1;
+	}
+#endif
+
 	return 0;
 }
 
@@ -281,6 +329,22 @@ int mmc_found(void)
 
 	wait_prog_done();
 
+#ifndef CONFIG_FPGA
+	{
+		/* EXT_CSD scratch space is the U-Boot load area */
+		u8 *ext_csd = (u8 *)CONFIG_SYS_TEXT_BASE;
+
+		if (!mmc_read_data(MMC_CMD_SEND_EXT_CSD, 0, (u32 *)ext_csd, 512) &&
+		    (ext_csd[EXT_CSD_CARD_TYPE] & EXT_CSD_CARD_TYPE_52)) {
+			resp = mmc_cmd(6, (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
+				       (EXT_CSD_HS_TIMING << 16) | (1 << 8),
+				       0x41, MSC_CMDAT_RESPONSE_R1); /* hs timing */
+			wait_prog_done();
+			highspeed = 1;
+		}
+	}
+#endif
+
 	return 0;
 }
 
@@ -335,6 +399,19 @@ static int jzmmc_init()
 		ret = mmc_found();
 	}
 
+#ifndef CONFIG_FPGA
+	if (highspeed) {
+		clk_set_rate(MSC0, CONFIG_SPL_JZMMC_HS_RATE);
+		msc_writel(MSC_CLKRT, MSC_CLKRT_CLK_RATE_DIV_1);
+		if (clk_get_rate(MSC0) > 25000000)
+			msc_writel(MSC_LPM, LPM_LPM | (0x2 << LPM_DRV_SEL_SHF) | LPM_SMP_SEL);
+	}
+	msc_debug("highspeed:%d, clk:%d\n", highspeed, clk_get_rate(MSC0));
+#endif
+
+	/* block length never changes, set it once instead of before every read */
+	mmc_cmd(MMC_CMD_SET_BLOCKLEN, 0x200, 0x1, MSC_CMDAT_RESPONSE_R1);
+
 	return 0;
 }
 
@@ -357,22 +434,34 @@ static int mmc_load_image_raw(unsigned long sector)
 	u32 image_size_sectors;
 	struct image_header *header;
 
-	header = (struct image_header *)(CONFIG_SYS_TEXT_BASE -
-					 sizeof(struct image_header));
+	/*
+	 * A raw u-boot.bin is loaded at CONFIG_SYS_TEXT_BASE, so reading the
+	 * first block there usually puts it at its final place already.
+	 */
+	header = (struct image_header *)CONFIG_SYS_TEXT_BASE;
 
 	/* read image header to find the image size & load address */
-	err = mmc_block_read(sector, 1, header);
-	if (err < 0)
+	err = mmc_block_read(sector, 1, (u32 *)header);
+	if (err < 1) {
+		err = -1;
 		goto end;
+	}
 
 	spl_parse_image_header(header);
 
 	/* convert size to sectors - round up */
 	image_size_sectors = (spl_image.size + 0x200 - 1) / 0x200;
 
-	/* Read the header too to avoid extra memcpy */
-	err = mmc_block_read(sector, image_size_sectors,
-			     (void *)spl_image.load_addr);
+	if (spl_image.load_addr == (u32)header) {
+		/* stream the rest of the image behind the first block */
+		if (image_size_sectors > 1)
+			err = mmc_block_read(sector + 1, image_size_sectors - 1,
+					     (u32 *)(spl_image.load_addr + 0x200));
+	} else {
+		/* Read the header too to avoid extra memcpy */
+		err = mmc_block_read(sector, image_size_sectors,
+				     (void *)spl_image.load_addr);
+	}
 
 #ifdef DEBUG_DDR_CONTENT
 	dump_ddr_content(spl_image.load_addr, 200);
@@ -394,5 +483,6 @@ void spl_mmc_load_image(void)
 #endif
 
 	jzmmc_init();
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_FLASH_PROBE, "mmc_init");
 	mmc_load_image_raw(CONFIG_SYS_MMCSD_RAW_MODE_U_BOOT_SECTOR);
 }
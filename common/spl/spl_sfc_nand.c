@@ -220,23 +220,51 @@ static int sfc_nand_read_data(unsigned int *data, unsigned int length)
 	return 0;
 }
 
-static void get_sfcnand_base_param(int *pagesize)
+static void get_sfcnand_base_param(int *pagesize, int *ppb)
 {
 	unsigned char *spl_flag = (unsigned char *)0xF4001000;
 	int type_len = SPL_TYPE_FLAG_LEN;
 
 	*pagesize = spl_flag[type_len + 5] * 1024;//pagesize off 5,blocksize off 4
+	*ppb = spl_flag[type_len + 4] * 32;//pages per block / 32, see add_information_to_spl()
 }
 
-static int sfc_read_page(unsigned int page,unsigned char *dst_addr,int pagesize)
+static unsigned int sfc_nand_wait_ready(void)
+{
+	unsigned char cmd[5];
+	volatile unsigned int read_buf;
+
+	cmd[0]=0x0f;//get feature
+	do {
+		read_buf = 0;
+		sfc_send_cmd(&cmd[0],1,0xc0,1,0,1,0);
+		sfc_nand_read_data(&read_buf,1);
+	} while(read_buf & 0x1);
+
+	return read_buf;
+}
+
+static void sfc_read_cache(unsigned char *dst_addr,int pagesize)
 {
 	unsigned char cmd[5];
-	unsigned int src_addr;
-	volatile unsigned int read_buf=0;
-	u_char dummy;
 	int column = 0;
-	int t_read = 120;
-	unsigned int i=0;
+
+#ifdef CONFIG_SPI_QUAD
+	cmd[0]=0x6b;//read from cache x4
+	mode = TRAN_SPI_QUAD;
+#else
+	cmd[0]=0x03;//read from cache
+#endif
+	column=(column<<8)&0xffffff00;
+	sfc_send_cmd(&cmd[0],pagesize,column,3,0,1,0);
+	sfc_nand_read_data(dst_addr,pagesize);
+	mode = 0;
+}
+
+static int sfc_read_page(unsigned int page,unsigned char *dst_addr,int pagesize)
+{
+	unsigned char cmd[5];
+	unsigned int read_buf;
 
 	/* the paraterms is
 	* cmd , datelen,
@@ -248,45 +276,109 @@ static int sfc_read_page(unsigned int page,unsigned char *dst_addr,int pagesize)
 	cmd[0]=0x13;//
 	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
 
-	cmd[0]=0x0f;//get feature
-	sfc_send_cmd(&cmd[0],1,0xc0,1,0,1,0);
-	sfc_nand_read_data(&read_buf,1);
-
-	while((read_buf & 0x1))
-	{
-		cmd[0]=0x0f;//get feature
-		sfc_send_cmd(&cmd[0],1,0xc0,1,0,1,0);
-		sfc_nand_read_data(&read_buf,1);
-	}
+	read_buf = sfc_nand_wait_ready();
 	if((read_buf & 0x30) == 0x20)
 	{
 		printf("read error pageid\n");
 		return -1;
 	}
-	cmd[0]=0x03;//get feature
-	column=(column<<8)&0xffffff00;
-	sfc_send_cmd(&cmd[0],pagesize,column,3,0,1,0);
-	sfc_nand_read_data(dst_addr,pagesize);
-//	printf("---------column=%d,dst_addr=%x,pagesize=%d\n",column,dst_addr,pagesize);
+	sfc_read_cache(dst_addr,pagesize);
+	return 0;
 }
 
-void sfc_nand_load(long offs,long size,void *dst)
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+/* sequential cache read of @count pages inside one block, see jz_sfcnand.c */
+static int sfc_read_pages(unsigned int page,unsigned char *dst_addr,int count,int pagesize)
 {
-	int pagesize,page;
-	int pagecopy_cnt = 0;
-	unsigned int i=0;
-	get_sfcnand_base_param(&pagesize);
-	unsigned char *buf=dst;
+	unsigned char cmd[5];
+	unsigned int read_buf;
+	int ret = 0;
+
+	cmd[0]=0x13;//
+	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
+	sfc_nand_wait_ready();
+
+	while(count--) {
+		cmd[0] = count ? 0x31 : 0x3f;//read page cache sequential/last
+		sfc_send_cmd(&cmd[0],0,0,0,0,0,0);
+
+		read_buf = sfc_nand_wait_ready();
+		if((read_buf & 0x30) == 0x20) {
+			printf("read error pageid\n");
+			ret = -1;
+		}
+		sfc_read_cache(dst_addr,pagesize);
+		dst_addr += pagesize;
+	}
+	return ret;
+}
+#endif
+
+/* returns -1 if any page failed, the image must not be used then */
+int sfc_nand_load(long offs,long size,void *dst)
+{
+	int pagesize,page,ppb;
+	int count;
+	get_sfcnand_base_param(&pagesize,&ppb);
 	page = offs / pagesize;
-	while (pagecopy_cnt * pagesize < size) {
-		sfc_read_page(page,(unsigned char *)dst,pagesize);
+	count = (size + pagesize - 1) / pagesize;
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+	/* an old spl head carries no block size */
+	if (!ppb)
+		ppb = CONFIG_SPI_NAND_PPB;
+	while (count > 0) {
+		int n = ppb - page % ppb;
+
+		if (n > count)
+			n = count;
+		if (sfc_read_pages(page,(unsigned char *)dst,n,pagesize))
+			return -1;
+
+		dst += n * pagesize;
+		page += n;
+		count -= n;
+	}
+#else
+	while (count--) {
+		if (sfc_read_page(page,(unsigned char *)dst,pagesize))
+			return -1;
 
 		dst += pagesize;
 		page++;
-		pagecopy_cnt++;
 	}
-	return ;
+#endif
+	return 0;
+}
+
+#ifdef CONFIG_SPL_OS_BOOT
+static int sfc_nand_os_read(unsigned int offs, unsigned int len, void *dst)
+{
+	return sfc_nand_load(offs, len, dst);
+}
+#endif
+
+#ifdef CONFIG_SPI_QUAD
+static void sfc_nand_enable_quad(void)
+{
+	unsigned char cmd[5];
+	volatile unsigned int feature = 0;
+
+	cmd[0]=0x0f;//get feature
+	sfc_send_cmd(&cmd[0],1,0xb0,1,0,1,0);
+	sfc_nand_read_data(&feature,1);
+
+	feature = (feature & 0xff) | 0x1;//QE
+	cmd[0]=0x1f;//set feature
+	sfc_send_cmd(&cmd[0],1,0xb0,1,0,1,1);
+	while (!(jz_sfc_readl(SFC_SR) & TRAN_REQ))
+		;
+	jz_sfc_writel(CLR_TREQ,SFC_SCR);
+	jz_sfc_writel(feature,SFC_DR);
+	while (!(jz_sfc_readl(SFC_SR) & END))
+		;
+	jz_sfc_writel(CLR_END,SFC_SCR);
 }
+#endif
 
 static void sfc_init(void)
 {
@@ -334,9 +426,21 @@ void spl_sfc_nand_load_image(void)
 	header = (struct image_header *)(CONFIG_SYS_TEXT_BASE);
 
 	sfc_init();
+#ifdef CONFIG_SPI_QUAD
+	sfc_nand_enable_quad();
+#endif
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_FLASH_PROBE, "sfc_nand_init");
+
+#ifdef CONFIG_SPL_OS_BOOT
+	if (!spl_start_uboot() && !spl_load_os_image(sfc_nand_os_read, CONFIG_SPL_OS_OFFSET))
+		return;
+#endif
 
 	spl_parse_image_header(header);
-	sfc_nand_load(CONFIG_UBOOT_OFFSET,CONFIG_SYS_MONITOR_LEN,(void *)CONFIG_SYS_TEXT_BASE);
+	if (sfc_nand_load(CONFIG_UBOOT_OFFSET,CONFIG_SYS_MONITOR_LEN,(void *)CONFIG_SYS_TEXT_BASE)) {
+		puts("spl: u-boot read error\n");
+		hang();
+	}
 /*	sfc_read_page(0x100000/2048,0x80100000,2048);
 	for(i=0;i<2048;)
 	{
@@ -163,7 +163,7 @@ void sfc_init()
 }
 
 
-void sfc_nor_load(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
+int sfc_nor_load(unsigned int src_addr, unsigned int count,unsigned int dst_addr)
 {
 
 	int i,j;
@@ -187,10 +187,15 @@ void sfc_nor_load(unsigned int src_addr, unsigned int count,unsigned int dst_add
 		printf("sfc read error\n");
 	}
 
-	return ;
+	return ret;
 }
 
 #ifdef CONFIG_SPL_OS_BOOT
+static int sfc_nor_os_read(unsigned int offs, unsigned int len, void *dst)
+{
+	return sfc_nor_load(offs, len, (unsigned int)dst);
+}
+
 static void nv_map_area(unsigned int *base_addr, unsigned int nv_addr, unsigned int blocksize)
 {
 	unsigned int buf[3][2];
@@ -250,13 +255,12 @@ void spl_sfc_nor_load_image(void)
 	jz_sfc_writel(1 << 2,SFC_TRIG);
 
 	sfc_init();
+	bootstage_mark_name(BOOTSTAGE_ID_SPL_FLASH_PROBE, "sfc_nor_init");
 
 #ifdef CONFIG_SPL_OS_BOOT
 #ifdef CONFIG_NOR_SPL_BOOT_OS /* norflash spl boot kernel */
-	sfc_nor_load(bootimg_addr, sizeof(struct image_header), CONFIG_SYS_TEXT_BASE);
-	spl_parse_image_header(header);
-	sfc_nor_load(bootimg_addr, spl_image.size, spl_image.load_addr);
-	return ;
+	if (!spl_start_uboot() && !spl_load_os_image(sfc_nor_os_read, bootimg_addr))
+		return ;
 #else //not defined CONFIG_NOR_SPL_BOOT_OS
 #ifdef CONFIG_OTA_VERSION20
 	sfc_nor_load(CONFIG_SPI_NORFLASH_PART_OFFSET, sizeof(struct norflash_partitions), &partition);
@@ -277,18 +281,13 @@ void spl_sfc_nor_load_image(void)
 	sfc_nor_load(src_addr, count, nv_buf);
 	updata_flag = nv_buf[3];
 #endif
-	if((updata_flag & 0x3) != 0x3)
-	{
-		sfc_nor_load(bootimg_addr, sizeof(struct image_header), CONFIG_SYS_TEXT_BASE);
-		spl_parse_image_header(header);
-		sfc_nor_load(bootimg_addr, spl_image.size, spl_image.load_addr);
-	} else
+	if ((updata_flag & 0x3) != 0x3 && !spl_start_uboot() &&
+	    !spl_load_os_image(sfc_nor_os_read, bootimg_addr))
+		return ;
 #endif
 #endif
-	{
-		spl_parse_image_header(header);
-		sfc_nor_load(CONFIG_UBOOT_OFFSET, CONFIG_SYS_MONITOR_LEN,CONFIG_SYS_TEXT_BASE);
-	}
+	spl_parse_image_header(header);
+	sfc_nor_load(CONFIG_UBOOT_OFFSET, CONFIG_SYS_MONITOR_LEN,CONFIG_SYS_TEXT_BASE);
 	return ;
 
 }
@@ -0,0 +1,289 @@
+/*
+ * X1000 PDMA driver
+ *
+ * Channels are handed out with jz_dma_request(), each owning a chain of
+ * JZ_DMA_NR_DESC hardware descriptors. dma_memcpy()/dma_memset() sit on
+ * top for the memory to memory users (cp, fb_fill, bootm, lzop).
+ *
+ * TODO: the SFC and MSC controllers still run their own DMA engines and
+ * the SPI (SSI) driver is PIO only; none of them use these channels yet.
+ *
+ * Copyright (c) 2013 Ingenic Semiconductor Co.,Ltd
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <asm/io.h>
+#include <asm/errno.h>
+#include <asm/addrspace.h>
+#include <asm/arch/cpm.h>
+#include <asm/arch/dma.h>
+
+#define JZ_DMA_TIMEOUT		1000	/* ms, for the memory helpers */
+/* plus 1 ms per 4KB, far below what the PDMA moves between DDR */
+#define JZ_DMA_TIMEOUT_LEN(len)	(JZ_DMA_TIMEOUT + ((len) >> 12))
+
+/* one page of descriptors, one row per channel */
+static struct jz_dma_desc jz_dma_chain[JZ_DMA_NR_CHAN][JZ_DMA_NR_DESC]
+	__attribute__ ((aligned(4096)));
+
+static struct {
+	int busy;
+	int nr_desc;
+} jz_dma_chan[JZ_DMA_NR_CHAN];
+
+static int jz_dma_inited;
+static int memcpy_chan = -1;
+
+/* unit size for each DMAC_DCMD_DS_* value */
+static const unsigned int jz_dma_unit[] = { 4, 1, 2, 16, 32, 64, 128 };
+
+static void jz_dma_init(void)
+{
+	writel(readl(CPM_BASE + CPM_CLKGR) & ~CPM_CLKGR_PDMA,
+	       CPM_BASE + CPM_CLKGR);
+	writel(0, PDMA_BASE + DMACP);	/* all channels belong to the cpu */
+	writel(DMAC_DMAE, PDMA_BASE + DMAC);
+	jz_dma_inited = 1;
+}
+
+int jz_dma_request(void)
+{
+	int chan;
+
+	if (!jz_dma_inited)
+		jz_dma_init();
+
+	for (chan = 0; chan < JZ_DMA_NR_CHAN; chan++) {
+		if (!jz_dma_chan[chan].busy) {
+			jz_dma_chan[chan].busy = 1;
+			jz_dma_chan[chan].nr_desc = 0;
+			return chan;
+		}
+	}
+	return -EBUSY;
+}
+
+void jz_dma_free(int chan)
+{
+	writel(0, JZ_DMA_CH(chan) + CH_DCS);
+	jz_dma_chan[chan].busy = 0;
+}
+
+int jz_dma_add(int chan, unsigned long dst, unsigned long src,
+	       unsigned int len, unsigned int dcm, unsigned int drt)
+{
+	unsigned int unit = jz_dma_unit[(dcm & DMAC_DCMD_DS_MASK) >> 8];
+	int nr = jz_dma_chan[chan].nr_desc;
+	struct jz_dma_desc *desc = &jz_dma_chain[chan][nr];
+
+	if (nr == JZ_DMA_NR_DESC)
+		return -ENOMEM;
+	if (len % unit || len / unit > 0xffffff)
+		return -EINVAL;
+
+	if (nr) {
+		desc[-1].dcm |= DMAC_DCMD_LINK;
+		desc[-1].dtc |= ((virt_to_phys(desc) >> 4) & 0xff) << 24;
+	}
+
+	desc->dcm = dcm & ~DMAC_DCMD_LINK;
+	desc->dsa = src;
+	desc->dta = dst;
+	desc->dtc = len / unit;
+	desc->sd = 0;
+	desc->drt = drt;
+	jz_dma_chan[chan].nr_desc = nr + 1;
+
+	return 0;
+}
+
+int jz_dma_start(int chan)
+{
+	unsigned long base = JZ_DMA_CH(chan);
+	struct jz_dma_desc *desc = jz_dma_chain[chan];
+
+	if (!jz_dma_chan[chan].nr_desc)
+		return -EINVAL;
+
+	flush_dcache_range((ulong)desc,
+			   (ulong)(desc + jz_dma_chan[chan].nr_desc));
+
+	writel(0, base + CH_DCS);
+	writel(virt_to_phys(desc), base + CH_DDA);
+	writel(1 << chan, PDMA_BASE + DDRS);
+	writel(DMAC_DCCSR_DES8 | DMAC_DCCSR_EN, base + CH_DCS);
+
+	return 0;
+}
+
+int jz_dma_wait(int chan, unsigned int timeout_ms)
+{
+	unsigned long base = JZ_DMA_CH(chan);
+	ulong start = get_timer(0);
+	unsigned int dcs;
+	int ret = 0;
+
+	while (!((dcs = readl(base + CH_DCS)) &
+		 (DMAC_DCCSR_TT | DMAC_DCCSR_AR))) {
+		if (get_timer(start) > timeout_ms) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	if (dcs & DMAC_DCCSR_AR) {
+		printf("jz_dma: channel %d address error\n", chan);
+		ret = -EIO;
+		writel(readl(PDMA_BASE + DMAC) & ~(DMAC_AR | DMAC_HLT),
+		       PDMA_BASE + DMAC);
+	}
+
+	writel(0, base + CH_DCS);
+	jz_dma_chan[chan].nr_desc = 0;
+
+	return ret;
+}
+
+/* the PDMA sees physical addresses, stay in the unmapped segments */
+static int jz_dma_addr_ok(unsigned long addr, size_t len)
+{
+	return addr >= KSEG0 && addr + len <= KSEG2 && addr + len > addr;
+}
+
+/* largest unit both addresses are aligned to, 0 if not even words */
+static unsigned int jz_dma_pick_unit(unsigned long dst, unsigned long src,
+				     unsigned int *ds)
+{
+	unsigned long align = dst | src;
+
+	if (!(align & 31)) {
+		*ds = DMAC_DCMD_DS_32BYTE;
+		return 32;
+	}
+	if (!(align & 15)) {
+		*ds = DMAC_DCMD_DS_16BYTE;
+		return 16;
+	}
+	if (!(align & 3)) {
+		*ds = DMAC_DCMD_DS_32BIT;
+		return 4;
+	}
+	return 0;
+}
+
+/* run one memory to memory descriptor on the shared channel */
+static int jz_dma_mem(unsigned long dst, unsigned long src,
+		      unsigned int len, unsigned int dcm)
+{
+	int ret;
+
+	if (memcpy_chan < 0) {
+		memcpy_chan = jz_dma_request();
+		if (memcpy_chan < 0)
+			return memcpy_chan;
+	}
+
+	ret = jz_dma_add(memcpy_chan, virt_to_phys((void *)dst),
+			 virt_to_phys((void *)src), len, dcm, DMAC_DRSR_RS_AUTO);
+	if (!ret)
+		ret = jz_dma_start(memcpy_chan);
+	/*
+	 * jz_dma_wait() disables the channel on any error, so the CPU
+	 * fallback of the callers never races a running transfer.
+	 */
+	if (!ret)
+		ret = jz_dma_wait(memcpy_chan, JZ_DMA_TIMEOUT_LEN(len));
+	return ret;
+}
+
+void *dma_memcpy(void *dst, const void *src, size_t len)
+{
+	unsigned long d = (unsigned long)dst, s = (unsigned long)src;
+	unsigned int unit, ds, body;
+
+	if (len < CONFIG_JZ_PDMA_THRESHOLD ||
+	    !jz_dma_addr_ok(d, len) || !jz_dma_addr_ok(s, len) ||
+	    (d < s + len && s < d + len))
+		return memcpy(dst, src, len);
+
+	unit = jz_dma_pick_unit(d, s, &ds);
+	if (!unit)
+		return memcpy(dst, src, len);
+
+	/* jz_dma_start() syncs once for the buffers and the chain */
+	body = len & ~(unit - 1);
+	flush_dcache_range_nosync(s, s + body);
+	flush_dcache_range_nosync(d, d + body);
+	if (jz_dma_mem(d, s, body, DMAC_DCMD_SAI | DMAC_DCMD_DAI | ds))
+		return memcpy(dst, src, len);
+	invalidate_dcache_range(d, d + body);
+
+	if (len > body)
+		memcpy(dst + body, src + body, len - body);
+	return dst;
+}
+
+static void jz_cpu_fill32(u32 *p, u32 val, size_t words)
+{
+	while (words--)
+		*p++ = val;
+}
+
+void *dma_memset32(void *s, u32 val, size_t len)
+{
+	static u32 pattern[8] __attribute__ ((aligned(32)));
+	unsigned long d = (unsigned long)s;
+	unsigned int head, body, i;
+
+	if (len < CONFIG_JZ_PDMA_THRESHOLD || !jz_dma_addr_ok(d, len)) {
+		jz_cpu_fill32(s, val, len / 4);
+		return s;
+	}
+
+	/* the source stays on one 32 byte pattern, the target walks */
+	head = ALIGN(d, 32) - d;
+	body = (len - head) & ~31;
+	for (i = 0; i < ARRAY_SIZE(pattern); i++)
+		pattern[i] = val;
+	flush_dcache_range_nosync((ulong)pattern, (ulong)(pattern + 8));
+
+	jz_cpu_fill32(s, val, head / 4);
+	flush_dcache_range_nosync(d + head, d + head + body);
+	if (jz_dma_mem(d + head, (unsigned long)pattern, body,
+		       DMAC_DCMD_DAI | DMAC_DCMD_DS_32BYTE)) {
+		jz_cpu_fill32(s, val, len / 4);
+		return s;
+	}
+	invalidate_dcache_range(d + head, d + head + body);
+	jz_cpu_fill32(s + head + body, val, (len - head - body) / 4);
+
+	return s;
+}
+
+void *dma_memset(void *s, int c, size_t len)
+{
+	unsigned long d = (unsigned long)s;
+	unsigned int head, body;
+
+	if (len < CONFIG_JZ_PDMA_THRESHOLD)
+		return memset(s, c, len);
+
+	c &= 0xff;
+	head = ALIGN(d, 4) - d;
+	body = (len - head) & ~3;
+	memset(s, c, head);
+	dma_memset32(s + head, c | c << 8 | c << 16 | c << 24, body);
+	memset(s + head + body, c, len - head - body);
+
+	return s;
+}
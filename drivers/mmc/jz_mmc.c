@@ -26,6 +26,7 @@
 #include <asm/arch/clk.h>
 #include <asm/arch/mmc.h>
 #include <asm/unaligned.h>
+#include <asm/cache.h>
 
 struct jz_mmc_priv {
 	uintptr_t base;
@@ -65,11 +66,126 @@ static void jz_mmc_writel(uint32_t value, struct jz_mmc_priv *priv, uintptr_t of
 	writel(value, priv->base + off);
 }
 
+#if defined(CONFIG_JZ_MMC_DMA) && !defined(CONFIG_SPL_BUILD)
+#define JZ_MMC_USE_DMA
+
+/* each descriptor moves at most 64KiB, a command never needs more than the table */
+#define JZ_MMC_DMA_DESC_NUM	16
+#define JZ_MMC_DMA_DESC_LEN	(64 * 1024)
+#define JZ_MMC_DMA_TIMEOUT	5000	/* ms */
+
+static struct jz_msc_dma_desc jz_mmc_desc[JZ_MMC_DMA_DESC_NUM]
+	__attribute__((aligned(ARCH_DMA_MINALIGN)));
+
+static int jz_mmc_can_dma(struct mmc_data *data)
+{
+	unsigned long addr;
+	unsigned int len = data->blocks * data->blocksize;
+
+	if (len > JZ_MMC_DMA_DESC_NUM * JZ_MMC_DMA_DESC_LEN)
+		return 0;
+
+	if (data->flags & MMC_DATA_WRITE)
+		return !((unsigned long)data->src & 3);
+
+	/* read buffers are invalidated, they must not share a cache line */
+	addr = (unsigned long)data->dest;
+	return !((addr | len) & (ARCH_DMA_MINALIGN - 1));
+}
+
+static void jz_mmc_dma_start(struct jz_mmc_priv *priv, struct mmc_data *data)
+{
+	unsigned long addr, start;
+	unsigned int len = data->blocks * data->blocksize;
+	unsigned int seg;
+	int i = 0;
+
+	if (data->flags & MMC_DATA_WRITE)
+		addr = (unsigned long)data->src;
+	else
+		addr = (unsigned long)data->dest;
+
+	/* write back and drop the data lines, nothing may be evicted meanwhile */
+	start = addr & ~(ARCH_DMA_MINALIGN - 1);
+	flush_dcache_range(start, ALIGN(addr + len, ARCH_DMA_MINALIGN));
+
+	while (len) {
+		seg = min(len, (unsigned int)JZ_MMC_DMA_DESC_LEN);
+		jz_mmc_desc[i].da = virt_to_phys((void *)addr);
+		jz_mmc_desc[i].len = seg;
+		addr += seg;
+		len -= seg;
+		if (len) {
+			jz_mmc_desc[i].nda = virt_to_phys(&jz_mmc_desc[i + 1]);
+			jz_mmc_desc[i].dcmd = MSC_DMACMD_LINK;
+		} else {
+			jz_mmc_desc[i].nda = 0;
+			jz_mmc_desc[i].dcmd = MSC_DMACMD_ENDI;
+		}
+		i++;
+	}
+	flush_dcache_range((unsigned long)jz_mmc_desc,
+			   (unsigned long)&jz_mmc_desc[JZ_MMC_DMA_DESC_NUM]);
+
+	jz_mmc_writel(virt_to_phys(jz_mmc_desc), priv, MSC_DMANDA);
+	jz_mmc_writel(MSC_DMAC_DMAEN | MSC_DMAC_INCR_32, priv, MSC_DMAC);
+}
+
+static int jz_mmc_dma_finish(struct jz_mmc_priv *priv, struct mmc_data *data)
+{
+	uint32_t done, stat;
+	ulong timebase;
+	int ret = 0;
+
+	/* reads are complete once the engine drained the fifo into memory */
+	if (data->flags & MMC_DATA_WRITE)
+		done = MSC_IREG_DATA_TRAN_DONE;
+	else
+		done = MSC_IREG_DATA_TRAN_DONE | MSC_IREG_DMA_DATA_DONE;
+
+	timebase = get_timer(0);
+	while ((jz_mmc_readl(priv, MSC_IREG) & done) != done) {
+		stat = jz_mmc_readl(priv, MSC_STAT);
+		if (stat & MSC_STAT_TIME_OUT_READ) {
+			ret = TIMEOUT;
+			break;
+		}
+		if (stat & (MSC_STAT_CRC_READ_ERROR | MSC_STAT_CRC_WRITE_ERROR_MASK)) {
+			ret = COMM_ERR;
+			break;
+		}
+		if (get_timer(timebase) > JZ_MMC_DMA_TIMEOUT) {
+			printf("jzmmc: dma %s timeout\n",
+			       (data->flags & MMC_DATA_WRITE) ? "write" : "read");
+			ret = TIMEOUT;
+			break;
+		}
+	}
+	jz_mmc_writel(done, priv, MSC_IREG);
+
+	if (!ret && (data->flags & MMC_DATA_WRITE)) {
+		while (!(jz_mmc_readl(priv, MSC_STAT) & MSC_STAT_PRG_DONE));
+		jz_mmc_writel(MSC_IREG_PRG_DONE, priv, MSC_IREG);
+	}
+
+	jz_mmc_writel(0, priv, MSC_DMAC);
+
+	if (data->flags & MMC_DATA_READ)
+		invalidate_dcache_range((unsigned long)data->dest,
+				(unsigned long)data->dest + data->blocks * data->blocksize);
+
+	return ret;
+}
+#endif
+
 static int jz_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 						struct mmc_data *data)
 {
 	struct jz_mmc_priv *priv = mmc->priv;
 	uint32_t stat, cmdat = 0;
+#ifdef JZ_MMC_USE_DMA
+	int dma = data && jz_mmc_can_dma(data);
+#endif
 
 	/* setup command */
 	jz_mmc_writel(cmd->cmdidx, priv, MSC_CMD);
@@ -85,6 +201,10 @@ static int jz_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 
 		jz_mmc_writel(data->blocks, priv, MSC_NOB);
 		jz_mmc_writel(data->blocksize, priv, MSC_BLKLEN);
+#ifdef JZ_MMC_USE_DMA
+		if (dma)
+			cmdat |= MSC_CMDAT_DMA_EN;
+#endif
 	}
 
 	/* setup response */
@@ -123,6 +243,11 @@ static int jz_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 	jz_mmc_writel(0xffffffff, priv, MSC_IREG);
 #endif
 
+#ifdef JZ_MMC_USE_DMA
+	if (dma)
+		jz_mmc_dma_start(priv, data);
+#endif
+
 	/* start the command (& the clock) */
 	jz_mmc_writel(MSC_STRPCL_START_OP, priv, MSC_STRPCL);
 
@@ -130,8 +255,13 @@ static int jz_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 	while (!(stat = (jz_mmc_readl(priv, MSC_IREG) & (MSC_IREG_END_CMD_RES | MSC_IREG_TIME_OUT_RES))))
 		udelay(10000);
 	jz_mmc_writel(stat, priv, MSC_IREG);
-	if (stat & MSC_IREG_TIME_OUT_RES)
+	if (stat & MSC_IREG_TIME_OUT_RES) {
+#ifdef JZ_MMC_USE_DMA
+		if (dma)
+			jz_mmc_writel(0, priv, MSC_DMAC);
+#endif
 		return TIMEOUT;
+	}
 
 	if (cmd->resp_type & MMC_RSP_PRESENT) {
 		/* read the response */
@@ -156,6 +286,11 @@ static int jz_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 		jz_mmc_writel(MSC_IREG_PRG_DONE, priv, MSC_IREG);
 	}
 
+#ifdef JZ_MMC_USE_DMA
+	if (dma)
+		return jz_mmc_dma_finish(priv, data);
+#endif
+
 #ifndef CONFIG_SPL_BUILD
 	if (data && (data->flags & MMC_DATA_WRITE)) {
 		/* write the data */
@@ -354,6 +489,10 @@ static void jz_mmc_init_one(int idx, int controller, uintptr_t base, int clock)
 		MMC_VDD_32_33 | MMC_VDD_33_34 | MMC_VDD_34_35 | MMC_VDD_35_36;
 
 	mmc->f_min = 200000;
+#ifdef JZ_MMC_USE_DMA
+	/* keep every command within one descriptor table */
+	mmc->b_max = JZ_MMC_DMA_DESC_NUM * JZ_MMC_DMA_DESC_LEN / 512;
+#endif
 #ifdef CONFIG_SPL_BUILD
 	mmc->f_max = 24000000;
 #ifdef CONFIG_JZ_MMC_MSC0_PA_8BIT
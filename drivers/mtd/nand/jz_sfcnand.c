@@ -85,6 +85,353 @@ static int t_erase = 5000;
 static struct nand_ecclayout gd5f_ecc_layout_128 = {
 	.oobavail = 0,
 };
+
+extern int mode;
+static int sfcnand_quad_mode;
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+int sfc_nand_read_pages(u_char *buffer,int page,int count,size_t page_size);
+#endif
+int sfc_nand_read_page(u_char *buffer,int page,int column,size_t rlen);
+static int sfc_nand_read(struct mtd_info *mtd,loff_t addr,int column,size_t len,u_char *buf);
+
+#ifdef CONFIG_SFC_NAND_CACHE
+/*
+ * LRU cache of whole pages, data and spare, in front of the array reads.
+ * UBI attach, UBIFS, JFFS2 and the env come back to the same pages over
+ * and over and every miss costs a tRD plus the clock out, so the small
+ * reads are served from here.  A miss on the page right after the last
+ * miss reads a whole window ahead, into the next block only when the BBT
+ * says it is good.  Programs and erases drop the pages they touch.
+ */
+#ifndef CONFIG_SFC_NAND_CACHE_SIZE
+#define CONFIG_SFC_NAND_CACHE_SIZE	(CONFIG_SYS_MALLOC_LEN / 16)
+#endif
+#ifndef CONFIG_SFC_NAND_PREFETCH
+#define CONFIG_SFC_NAND_PREFETCH	16	/* pages */
+#endif
+#define SFCNAND_CACHE_HASH	64
+
+struct sfcnand_cpage {
+	struct list_head lru;
+	struct list_head hash;
+	int page;		/* -1 when free */
+	int ahead;		/* read ahead and not asked for yet */
+	u_char *data;
+};
+
+static struct sfcnand_cache {
+	struct sfcnand_cpage *pages;
+	u_char *data;
+	u_char *ra_buf;		/* landing area of the sequential cache read */
+	int nr;
+	int len;		/* writesize + oobsize */
+	int next;		/* page after the last miss */
+	struct list_head lru;	/* most recently used first */
+	struct list_head hash[SFCNAND_CACHE_HASH];
+	unsigned long hits, misses, ahead, ahead_hits, drops;
+} sfcnand_cache;
+
+static int sfcnand_block_isbad(struct mtd_info *mtd,loff_t ofs);
+
+static void sfcnand_cache_init(struct mtd_info *mtd)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	int i, stride;
+
+	free(c->pages);
+	free(c->data);
+	free(c->ra_buf);
+	memset(c, 0, sizeof(*c));
+	c->next = -1;
+	INIT_LIST_HEAD(&c->lru);
+	for (i = 0; i < SFCNAND_CACHE_HASH; i++)
+		INIT_LIST_HEAD(&c->hash[i]);
+
+	c->len = mtd->writesize + mtd->oobsize;
+	stride = ALIGN(c->len, ARCH_DMA_MINALIGN);
+	c->nr = CONFIG_SFC_NAND_CACHE_SIZE / stride;
+	c->pages = calloc(c->nr, sizeof(*c->pages));
+	c->data = memalign(ARCH_DMA_MINALIGN, c->nr * stride);
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+	c->ra_buf = memalign(ARCH_DMA_MINALIGN,
+			     CONFIG_SFC_NAND_PREFETCH * c->len);
+	if (!c->ra_buf)
+		c->nr = 0;
+#endif
+	if (!c->pages || !c->data)
+		c->nr = 0;
+	if (c->nr < 2 * CONFIG_SFC_NAND_PREFETCH) {
+		printf("sfcnand: no memory for the page cache\n");
+		free(c->pages);
+		free(c->data);
+		free(c->ra_buf);
+		c->pages = NULL;
+		c->data = c->ra_buf = NULL;
+		c->nr = 0;
+		return;
+	}
+
+	for (i = 0; i < c->nr; i++) {
+		struct sfcnand_cpage *p = &c->pages[i];
+
+		p->page = -1;
+		p->data = c->data + i * stride;
+		INIT_LIST_HEAD(&p->hash);
+		list_add_tail(&p->lru, &c->lru);
+	}
+}
+
+static struct sfcnand_cpage *sfcnand_cache_find(int page)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	struct sfcnand_cpage *p;
+
+	list_for_each_entry(p, &c->hash[page % SFCNAND_CACHE_HASH], hash)
+		if (p->page == page)
+			return p;
+	return NULL;
+}
+
+static void sfcnand_cache_free(struct sfcnand_cpage *p)
+{
+	list_del_init(&p->hash);
+	p->page = -1;
+	list_move_tail(&p->lru, &sfcnand_cache.lru);
+}
+
+/* a free entry to read @page into, the old copy of it if there is one */
+static struct sfcnand_cpage *sfcnand_cache_slot(int page)
+{
+	struct sfcnand_cpage *p = sfcnand_cache_find(page);
+
+	if (!p)
+		p = list_entry(sfcnand_cache.lru.prev, struct sfcnand_cpage, lru);
+	list_del_init(&p->hash);
+	p->page = -1;
+	return p;
+}
+
+static void sfcnand_cache_add(struct sfcnand_cpage *p, int page, int ahead)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+
+	p->page = page;
+	p->ahead = ahead;
+	list_add(&p->hash, &c->hash[page % SFCNAND_CACHE_HASH]);
+	list_move(&p->lru, &c->lru);
+	if (ahead)
+		c->ahead++;
+}
+
+/* pages to read for a sequential miss on @page */
+static int sfcnand_cache_window(struct mtd_info *mtd, int page)
+{
+	int ppb = mtd->erasesize / mtd->writesize;
+	int left = ppb - page % ppb;
+	loff_t next = (loff_t)(page + left) * mtd->writesize;
+
+	if (left >= CONFIG_SFC_NAND_PREFETCH)
+		return CONFIG_SFC_NAND_PREFETCH;
+	/* a bad block holds garbage and ECC errors, stop in front of it */
+	if (next >= mtd->size || sfcnand_block_isbad(mtd, next))
+		return left;
+	return CONFIG_SFC_NAND_PREFETCH;
+}
+
+/*
+ * Read @count pages from @page on into the cache and hand back the entry
+ * of the first one.  Only a failure on that first page is an error, the
+ * window just ends early on a failure further on.
+ */
+static struct sfcnand_cpage *sfcnand_cache_fill(struct mtd_info *mtd,
+						 int page, int count)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	struct sfcnand_cpage *p;
+	int n, first = page;
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+	int ppb = mtd->erasesize / mtd->writesize;
+	int i, seq = 1;
+#endif
+
+	while (count) {
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+		/* the sequential cache read stops at the block end */
+		n = min(count, ppb - page % ppb);
+		if (seq && n > 1) {
+			if (!sfc_nand_read_pages(c->ra_buf, page, n, c->len)) {
+				for (i = 0; i < n; i++) {
+					p = sfcnand_cache_slot(page + i);
+					memcpy(p->data, c->ra_buf + i * c->len,
+					       c->len);
+					sfcnand_cache_add(p, page + i,
+							  page + i != first);
+				}
+				page += n;
+				count -= n;
+				continue;
+			}
+			seq = 0;
+		}
+#endif
+		/* one at a time, also to find the page a run failed on */
+		n = 1;
+		p = sfcnand_cache_slot(page);
+		if (sfc_nand_read_page(p->data, page, 0, c->len) < 0)
+			break;
+		sfcnand_cache_add(p, page, page != first);
+		page += n;
+		count -= n;
+	}
+
+	if (page == first)
+		return NULL;
+	/* the window went in after the first page, put that one on top */
+	p = sfcnand_cache_find(first);
+	list_move(&p->lru, &c->lru);
+	return p;
+}
+
+static struct sfcnand_cpage *sfcnand_cache_get(struct mtd_info *mtd, int page)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	struct sfcnand_cpage *p;
+	int count = 1;
+
+	p = sfcnand_cache_find(page);
+	if (p) {
+		c->hits++;
+		if (p->ahead) {
+			c->ahead_hits++;
+			p->ahead = 0;
+		}
+		list_move(&p->lru, &c->lru);
+		return p;
+	}
+
+	c->misses++;
+	if (page == c->next)
+		count = sfcnand_cache_window(mtd, page);
+	c->next = page + count;
+
+	return sfcnand_cache_fill(mtd, page, count);
+}
+
+/* drop whatever the cache holds of [@addr, @addr + @len) */
+static void sfcnand_cache_drop(struct mtd_info *mtd, loff_t addr, size_t len)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	struct sfcnand_cpage *p;
+	int page = addr / mtd->writesize;
+	int last = (addr + max(len, (size_t)1) - 1) / mtd->writesize;
+
+	if (!c->nr)
+		return;
+	for (; page <= last; page++) {
+		p = sfcnand_cache_find(page);
+		if (p) {
+			sfcnand_cache_free(p);
+			c->drops++;
+		}
+	}
+	c->next = -1;
+}
+
+/*
+ * Byte granular read through the cache.  Runs of whole pages a window
+ * long or more go straight to @buf, they would only push the small
+ * reads the cache is for out of it.
+ */
+static int sfcnand_cache_read(struct mtd_info *mtd, loff_t addr, size_t len,
+			      u_char *buf)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	struct sfcnand_cpage *p;
+	int page_size = mtd->writesize;
+	int page, column, ret;
+	size_t rlen;
+
+	if (!c->nr)
+		return sfc_nand_read(mtd, addr, addr % page_size, len, buf);
+
+	while (len) {
+		page = addr / page_size;
+		column = addr % page_size;
+
+		if (!column && len >= CONFIG_SFC_NAND_PREFETCH * page_size) {
+			rlen = len - len % page_size;
+			ret = sfc_nand_read(mtd, addr, 0, rlen, buf);
+			if (ret < 0)
+				return ret;
+			c->next = page + rlen / page_size;
+		} else {
+			rlen = min(len, (size_t)(page_size - column));
+			p = sfcnand_cache_get(mtd, page);
+			if (!p)
+				return -1;
+			memcpy(buf, p->data + column, rlen);
+		}
+
+		addr += rlen;
+		buf += rlen;
+		len -= rlen;
+	}
+
+	return 0;
+}
+
+/* spare bytes of a page the cache holds anyway, -1 if it does not */
+static int sfcnand_cache_read_oob(struct mtd_info *mtd, loff_t addr,
+				  size_t len, u_char *buf)
+{
+	struct sfcnand_cpage *p;
+
+	if (!sfcnand_cache.nr || len > mtd->oobsize)
+		return -1;
+	p = sfcnand_cache_find(addr / mtd->writesize);
+	if (!p)
+		return -1;
+	sfcnand_cache.hits++;
+	memcpy(buf, p->data + mtd->writesize, len);
+	return 0;
+}
+
+void sfcnand_cache_flush(void)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	int i;
+
+	for (i = 0; i < c->nr; i++)
+		if (c->pages[i].page >= 0)
+			sfcnand_cache_free(&c->pages[i]);
+	c->next = -1;
+}
+
+void sfcnand_cache_stats(void)
+{
+	struct sfcnand_cache *c = &sfcnand_cache;
+	unsigned long total = c->hits + c->misses;
+	int i, used = 0;
+
+	for (i = 0; i < c->nr; i++)
+		if (c->pages[i].page >= 0)
+			used++;
+
+	printf("page cache: %d of %d pages in use, %d KB\n", used, c->nr,
+	       c->nr * ALIGN(c->len, ARCH_DMA_MINALIGN) >> 10);
+	printf("hits %lu, misses %lu", c->hits, c->misses);
+	if (total)
+		printf(" (%lu%% hit)", c->hits * 100 / total);
+	printf("\nread ahead %lu pages, %lu of them used\n",
+	       c->ahead, c->ahead_hits);
+	printf("dropped by program/erase %lu\n", c->drops);
+}
+#else
+static inline void sfcnand_cache_drop(struct mtd_info *mtd, loff_t addr,
+				      size_t len)
+{
+}
+#endif
 int sfc_nand_erase(struct mtd_info *mtd,int addr)
 {
 	unsigned char cmd[COMMAND_MAX_LENGTH];
@@ -92,6 +439,8 @@ int sfc_nand_erase(struct mtd_info *mtd,int addr)
 	int page = addr / mtd->writesize;
 	int block_size = mtd->erasesize;
 
+	sfcnand_cache_drop(mtd,addr - addr % block_size,block_size);
+
 	switch(block_size){
 		case 4 * 1024:
 			erase_cmd = CMD_ERASE_4K;
@@ -117,6 +466,11 @@ int sfc_nand_erase(struct mtd_info *mtd,int addr)
 	*
 	* */
 	volatile unsigned int x;
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+	/* WREN + erase + status polling in one trigger */
+	cmd[0]=erase_cmd;
+	x = sfc_send_cmd_poll(&cmd[0],0,page,3,NULL,CMD_GET_FEATURE,FEATURE_ADDR,1);
+#else
 	cmd[0] = CMD_WREN;//write en
 	sfc_send_cmd(&cmd[0],0,0,0,0,0,0);
 	memset(cmd,COMMAND_MAX_LENGTH,0);
@@ -130,10 +484,12 @@ int sfc_nand_erase(struct mtd_info *mtd,int addr)
 	x=x&0x000000ff;
 	while(x & 0x1)
 	{
+		sfc_busy_hook();
 		x=0;
 		sfc_send_cmd(&cmd[0],1,0xc0,1,0,1,0);
 		sfc_nand_read_data(&x,1);
 	}
+#endif
 	if(x & E_FAIL)
 		return -1;
 
@@ -149,6 +505,8 @@ static int sfc_nand_write(struct mtd_info *mtd,loff_t addr,int column,size_t len
 	u_char *buffer = buf;
 	page = addr/page_size;
 
+	sfcnand_cache_drop(mtd,addr,len);
+
 	write_num = (len + page_size - 1) / page_size;
 	for(i = 0; i < write_num; i++)
 	{
@@ -166,7 +524,6 @@ static int sfc_nand_write(struct mtd_info *mtd,loff_t addr,int column,size_t len
 		* */
 
 		cmd[0]=CMD_PRO_LOAD;//get feature
-		sfc_send_cmd(&cmd[0],wlen,column,2,0,1,1);
 
 		ops_len = wlen;
 	/*	while(ops_len) {
@@ -180,8 +537,13 @@ static int sfc_nand_write(struct mtd_info *mtd,loff_t addr,int column,size_t len
 				ops_len = 0;
 			}
 		}*/
-		sfc_nand_write_data(buffer,ops_len);
+		sfc_xfer_data(&cmd[0],ops_len,column,2,0,buffer,1);
 		buffer += ops_len;
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+		/* WREN + program execute + status polling in one trigger */
+		cmd[0] = CMD_PE;
+		state = sfc_send_cmd_poll(&cmd[0],0,page,3,NULL,CMD_GET_FEATURE,FEATURE_ADDR,1);
+#else
 		cmd[0] = CMD_WREN;
 		sfc_send_cmd(&cmd[0],0,0,0,0,0,0);
 
@@ -195,10 +557,12 @@ static int sfc_nand_write(struct mtd_info *mtd,loff_t addr,int column,size_t len
 		sfc_nand_read_data(&state,1);
 		while(state & 0x1) ///////////////////////////////////////////
 		{
+			sfc_busy_hook();
 			cmd[0] = CMD_GET_FEATURE;
 			sfc_send_cmd(&cmd[0],1,FEATURE_ADDR,1,0,1,0);
 			sfc_nand_read_data(&state,1);
 		}
+#endif
 
 		if(state & P_FAIL){
 			printf("WARNING: write fail !\n");
@@ -259,6 +623,25 @@ static int sfc_nand_read(struct mtd_info *mtd,loff_t addr,int column,size_t len,
                 read_num = (len + page_size - 1) / page_size;
                 page = addr / page_size;
                 for(i = 0; i < read_num; i++){
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+                        int ppb = mtd->erasesize / page_size;
+                        int seq_num = len / page_size;
+
+                        /* the sequential cache read stops at the block end */
+                        if(seq_num > ppb - page % ppb)
+                                seq_num = ppb - page % ppb;
+                        if(seq_num > 1){
+                                ret = sfc_nand_read_pages(buffer,page,seq_num,page_size);
+                                if(ret < 0)
+                                        return ret;
+
+                                buffer += seq_num * page_size;
+                                len -= seq_num * page_size;
+                                page += seq_num;
+                                i += seq_num - 1;
+                                continue;
+                        }
+#endif
                         if(len >= page_size)
                                 rlen = page_size;
                         else
@@ -275,48 +658,109 @@ static int sfc_nand_read(struct mtd_info *mtd,loff_t addr,int column,size_t len,
         }
         return 0;
 }
-int sfc_nand_read_page(u_char *buffer,int page,int column,size_t rlen)
+static unsigned int sfc_nand_wait_ready(void)
 {
 	unsigned char cmd[COMMAND_MAX_LENGTH];
 	volatile unsigned int read_buf;
 
-	cmd[0]=CMD_PARD;//
-	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
-
 	cmd[0]=CMD_GET_FEATURE;//get feature
-	sfc_send_cmd(&cmd[0],1,FEATURE_ADDR,1,0,1,0);
-	sfc_nand_read_data(&read_buf,1);
-	//	printf("read_buf=%08x\n",read_buf);
-	while(read_buf & 0x1)
-	{
-		cmd[0]=CMD_GET_FEATURE;//get feature
+	do {
+		read_buf = 0;
 		sfc_send_cmd(&cmd[0],1,FEATURE_ADDR,1,0,1,0);
 		sfc_nand_read_data(&read_buf,1);
-	}
-	if((read_buf & 0x30) == 0x20) {
-		printf("%s %d read error pageid = %d!!!\n",__func__,__LINE__,page);
-		return -1;
-	}
+	} while(read_buf & SPINAND_IS_BUSY);
+
+	return read_buf & 0xff;
+}
+
+/*
+ * Clock the data out of the page cache.  In quad mode the x4 variant of the
+ * read from cache command is used, its address and dummy byte layout is the
+ * same as the x1 command of the chip.
+ */
+static int sfc_nand_read_cache(u_char *buffer,int column,size_t rlen)
+{
+	unsigned char cmd[COMMAND_MAX_LENGTH];
+	int addr_len;
+
 	switch(column_cmdaddr_bits){
-			case 24:
-				cmd[0]=CMD_R_CACHE;//get feature
-				column=(column<<8)&0xffffff00;
-				sfc_send_cmd(&cmd[0],rlen,column,3,0,1,0);
-				sfc_nand_read_data(buffer,rlen);
+		case 24:
+			cmd[0]=CMD_R_CACHE;
+			addr_len = 3;
 			break;
 		case 32:
-			cmd[0]=CMD_FR_CACHE;//get feature
-			column=(column<<8)&0xffffff00;
-			sfc_send_cmd(&cmd[0],rlen,column,4,0,1,0);
-			sfc_nand_read_data(buffer,rlen);
+			cmd[0]=CMD_FR_CACHE;
+			addr_len = 4;
 			break;
 		default:
 			printk("can't support the column addr format !!!\n");
-			break;
+			return -1;
+	}
+
+	if(sfcnand_quad_mode){
+		cmd[0]=CMD_QUAD_R_CACHE;
+		mode = TRAN_SPI_QUAD;
 	}
+	column=(column<<8)&0xffffff00;
+	sfc_xfer_data(&cmd[0],rlen,column,addr_len,0,buffer,0);
+	mode = TRAN_SPI_STANDARD;
 
 	return 0;
 }
+
+int sfc_nand_read_page(u_char *buffer,int page,int column,size_t rlen)
+{
+	unsigned char cmd[COMMAND_MAX_LENGTH];
+	unsigned int read_buf;
+
+	cmd[0]=CMD_PARD;//
+	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
+
+	read_buf = sfc_nand_wait_ready();
+	if((read_buf & 0x30) == 0x20) {
+		printf("%s %d read error pageid = %d!!!\n",__func__,__LINE__,page);
+		return -1;
+	}
+
+	return sfc_nand_read_cache(buffer,column,rlen);
+}
+
+#ifdef CONFIG_SFC_NAND_SEQ_READ
+/*
+ * Read @count whole pages with the sequential cache read: while page N is
+ * clocked out of the cache the array already senses page N+1, so only the
+ * first page pays the full tRD.  The pages must be inside one block.
+ */
+int sfc_nand_read_pages(u_char *buffer,int page,int count,size_t page_size)
+{
+	unsigned char cmd[COMMAND_MAX_LENGTH];
+	unsigned int read_buf;
+	int ret = 0;
+
+	cmd[0]=CMD_PARD;
+	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
+	sfc_nand_wait_ready();
+
+	while(count--){
+		/* moves the sensed page to the cache, the last one ends the sequence */
+		cmd[0] = count ? CMD_R_CACHE_SEQ : CMD_R_CACHE_END;
+		sfc_send_cmd(&cmd[0],0,0,0,0,0,0);
+
+		read_buf = sfc_nand_wait_ready();
+		if((read_buf & 0x30) == 0x20) {
+			printf("%s %d read error pageid = %d!!!\n",__func__,__LINE__,page);
+			ret = -1;
+		}
+
+		if(sfc_nand_read_cache(buffer,0,page_size))
+			return -1;
+		buffer += page_size;
+		page++;
+	}
+
+	return ret;
+}
+#endif
 static int sfcnand_write_oob(struct mtd_info *mtd,loff_t addr,struct mtd_oob_ops *ops)
 {
 	unsigned char cmd[COMMAND_MAX_LENGTH];
@@ -386,6 +830,10 @@ static int sfcnand_read_oob(struct mtd_info *mtd,loff_t addr,struct mtd_oob_ops
 	* dir 0,read 1.write
 	*
 	* */
+#ifdef CONFIG_SFC_NAND_CACHE
+	if(!sfcnand_cache_read_oob(mtd,addr,len,buffer))
+		return 0;
+#endif
 	cmd[0] = CMD_PARD;//write en
 	sfc_send_cmd(&cmd[0],0,page,3,0,0,0);
 	udelay(t_read);
@@ -483,7 +931,11 @@ static int sfcnand_read(struct mtd_info *mtd,loff_t addr,size_t len,size_t *retl
 {
 	int ret;
 
-	ret = sfc_nand_read(mtd,addr,0,len,buf);
+#ifdef CONFIG_SFC_NAND_CACHE
+	ret = sfcnand_cache_read(mtd,addr,len,buf);
+#else
+	ret = sfc_nand_read(mtd,addr,addr % mtd->writesize,len,buf);
+#endif
 	if(ret)
 		*retlen += ret;
 	else
@@ -529,7 +981,9 @@ static void jz_sfcnand_ext_init(void )
 
 	cmd[0]=0x1f;//get feature
 	add=0xb0;
-	x=0x10;
+	x=FEATURE_ECC_EN;
+	if(sfcnand_quad_mode)
+		x |= FEATURE_QE;
 	sfc_send_cmd(&cmd[0],1,add,1,0,1,1);
 	sfc_nand_write_data(&x,1);
 
@@ -557,6 +1011,11 @@ static int jz_sfcnand_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	int block, res, ret = 0, i = 0;
 	int write_oob = !(chip->bbt_options & NAND_BBT_NO_OOB_BBM);
 
+	block = (int)(ofs >> chip->bbt_erase_shift);
+	/* Mark block bad in memory-based BBT */
+	if (chip->bbt)
+		chip->bbt[block >> 2] |= 0x01 << ((block & 0x03) << 1);
+
 	/* Write bad block marker to OOB */
 	if (write_oob) {
 		struct mtd_oob_ops ops;
@@ -725,6 +1184,7 @@ int jz_sfc_nand_init(int sfc_quad_mode,struct nand_param_from_burner *param)
 	mtd = &nand_info[0];
 	int using_way;
 	sfc_for_nand_init(sfc_quad_mode);
+	sfcnand_quad_mode = sfc_quad_mode;
 #ifndef CONFIG_BURNER
         char *buffer=get_chip_param_from_nand(&param,&using_way);
 	if(using_way==1)		//use old way
@@ -750,7 +1210,7 @@ int jz_sfc_nand_init(int sfc_quad_mode,struct nand_param_from_burner *param)
 
 	chip->select_chip = NULL;
 	chip->badblockbits = 8;
-	chip->scan_bbt = nand_default_bbt;
+	chip->scan_bbt = nand_block_bad_bbt;
 	chip->block_bad = jz_sfcnand_block_bad_check;
 	chip->block_markbad = jz_sfcnand_block_markbad;
 	chip->ecc.layout= &gd5f_ecc_layout_128; // for erase ops
@@ -770,6 +1230,9 @@ int jz_sfc_nand_init(int sfc_quad_mode,struct nand_param_from_burner *param)
 
 	jz_sfcnand_ext_init();
 	mtd_sfcnand_init(mtd);
+#ifdef CONFIG_SFC_NAND_CACHE
+	sfcnand_cache_init(mtd);
+#endif
 	nand_register(0);
 	return 0;
 }
@@ -574,16 +574,9 @@ static int spinand_block_checkbad(struct mtd_info *mtd, loff_t ofs,int getchip,i
 	return nand_isbad_bbt(mtd, ofs, allowbbt);
 }
 
-static int blkid_bak = -1;
 static int spinand_block_isbad(struct mtd_info *mtd,loff_t ofs)
 {
-	int ret = 0;
-	int block_id = ofs / mtd->erasesize;
-	if(block_id != blkid_bak){
-		ret = spinand_block_checkbad(mtd, ofs,1, 0);
-		blkid_bak = block_id;
-	}
-	return ret;
+	return spinand_block_checkbad(mtd, ofs,1, 0);
 }
 static int jz_spinand_block_bad_check(struct mtd_info *mtd, loff_t ofs,int getchip)
 {
@@ -704,6 +697,11 @@ static int jz_spinand_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	int block, res, ret = 0, i = 0;
 	int write_oob = !(chip->bbt_options & NAND_BBT_NO_OOB_BBM);
 
+	block = (int)(ofs >> chip->bbt_erase_shift);
+	/* Mark block bad in memory-based BBT */
+	if (chip->bbt)
+		chip->bbt[block >> 2] |= 0x01 << ((block & 0x03) << 1);
+
 	/* Write bad block marker to OOB */
 	if (write_oob) {
 		struct mtd_oob_ops ops;
@@ -913,7 +911,7 @@ int jz_spi_nand_init(struct nand_param_from_burner *param)
 
 	chip->select_chip = NULL;
 	chip->badblockbits = 8;
-	chip->scan_bbt = nand_default_bbt;
+	chip->scan_bbt = nand_block_bad_bbt;
 	chip->block_bad = jz_spinand_block_bad_check;
 	chip->block_markbad = jz_spinand_block_markbad;
 	chip->ecc.layout= &gd5f_ecc_layout_128; // for erase ops
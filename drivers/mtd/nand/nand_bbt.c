@@ -1367,6 +1367,37 @@ int nand_default_bbt(struct mtd_info *mtd)
 	return nand_scan_bbt(mtd, this->badblock_pattern);
 }
 
+/**
+ * nand_block_bad_bbt - [NAND Interface] Build the memory table with block_bad
+ * @mtd: MTD device structure
+ *
+ * For drivers whose chip->block_bad() has its own bad block marker check,
+ * like the SPI NAND ones: one call a block fills the memory table that
+ * nand_isbad_bbt() answers from, instead of the exact pattern match over
+ * the whole spare area nand_scan_bbt() does.  No table is kept on flash.
+ */
+int nand_block_bad_bbt(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	int block, nr_blocks = mtd->size >> this->bbt_erase_shift;
+
+	kfree(this->bbt);
+	this->bbt = kzalloc(nr_blocks / 4 + 1, GFP_KERNEL);
+	if (!this->bbt)
+		return -ENOMEM;
+
+	mtd->ecc_stats.badblocks = 0;
+	for (block = 0; block < nr_blocks; block++) {
+		if (!this->block_bad(mtd, (loff_t)block << this->bbt_erase_shift, 0))
+			continue;
+		this->bbt[block >> 2] |= 0x03 << ((block & 0x03) << 1);
+		printk(KERN_INFO "Bad eraseblock %d at 0x%08x\n", block,
+		       block << this->bbt_erase_shift);
+		mtd->ecc_stats.badblocks++;
+	}
+	return 0;
+}
+
 /**
  * nand_isbad_bbt - [NAND Interface] Check if a block is bad
  * @mtd: MTD device structure
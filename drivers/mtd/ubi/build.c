@@ -453,19 +453,29 @@ static void uif_close(struct ubi_device *ubi)
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  *
- * Note, currently this is the only method to attach UBI devices. Hopefully in
- * the future we'll have more scalable attaching methods and avoid full media
- * scanning. But even in this case scanning will be needed as a fall-back
- * attaching method if there are some on-flash table corruptions.
+ * With %CONFIG_MTD_UBI_FASTMAP the scanning information is built from the
+ * on-flash fastmap if there is a valid one, full scanning is the fall-back.
+ * The time taken is reported either way.
  */
 static int attach_by_scanning(struct ubi_device *ubi)
 {
 	int err;
-	struct ubi_scan_info *si;
+	struct ubi_scan_info *si = NULL;
+	const char *method = "scanning";
+	ulong start = get_timer(0);
 
-	si = ubi_scan(ubi);
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	si = ubi_scan_fastmap(ubi);
 	if (IS_ERR(si))
 		return PTR_ERR(si);
+	if (si)
+		method = "fastmap";
+#endif
+	if (!si) {
+		si = ubi_scan(ubi);
+		if (IS_ERR(si))
+			return PTR_ERR(si);
+	}
 
 	ubi->bad_peb_count = si->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
@@ -485,6 +495,7 @@ static int attach_by_scanning(struct ubi_device *ubi)
 		goto out_eba;
 
 	ubi_scan_destroy_si(si);
+	ubi_msg("attached by %s in %lu ms", method, get_timer(start));
 	return 0;
 
 out_eba:
@@ -864,6 +875,9 @@ out_free:
 	vfree(ubi->peb_buf2);
 #ifdef CONFIG_MTD_UBI_DEBUG
 	vfree(ubi->dbg_peb_buf);
+#endif
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	kfree(ubi->fm_state);
 #endif
 	kfree(ubi);
 	return err;
@@ -927,6 +941,9 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	vfree(ubi->peb_buf2);
 #ifdef CONFIG_MTD_UBI_DEBUG
 	vfree(ubi->dbg_peb_buf);
+#endif
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	kfree(ubi->fm_state);
 #endif
 	ubi_msg("mtd%d is detached from ubi%d", ubi->mtd->index, ubi->ubi_num);
 	kfree(ubi);
@@ -0,0 +1,956 @@
+/*
+ * UBI fastmap support
+ *
+ * A fastmap is a snapshot of the WL and EBA state kept in a few PEBs: the
+ * erase counters of all PEBs, the EBA table of each volume and two pools of
+ * PEBs which may have been written after the snapshot was taken. Attaching
+ * from it reads the anchor area, the fastmap and the pool PEBs instead of
+ * the headers of every PEB on the device. The on-flash format is the one
+ * Linux uses, so a fastmap written by the kernel is picked up here and one
+ * written by 'ubi fastmap' is picked up by the kernel.
+ *
+ * U-Boot does not maintain the fastmap while writing. As long as only pool
+ * PEBs are touched the kernel still finds everything by scanning the pools,
+ * anything else erases the anchor first so that the next attach falls back
+ * to scanning.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <ubi_uboot.h>
+#include "ubi.h"
+
+/* returned by the parsing helpers when the fastmap cannot be trusted */
+#define FM_BAD		1
+
+/* per PEB bookkeeping while attaching, the fastmap lists must not overlap */
+enum {
+	FM_UNSEEN = 0,
+	FM_FREE,
+	FM_USED,
+	FM_USED_SCRUB,
+	FM_MAPPED,
+	FM_ERASE,
+	FM_POOL,
+	FM_SELF,
+};
+
+struct fm_attach {
+	struct ubi_scan_info *si;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vh;
+	unsigned char *seen;
+	int *ec;
+	int vol_count;
+	int vol_id[UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT];
+};
+
+static int fm_add_to_list(int pnum, int ec, struct list_head *list)
+{
+	struct ubi_scan_leb *seb;
+
+	seb = kmalloc(sizeof(struct ubi_scan_leb), GFP_KERNEL);
+	if (!seb)
+		return -ENOMEM;
+
+	seb->pnum = pnum;
+	seb->ec = ec;
+	seb->scrub = 0;
+	list_add_tail(&seb->u.list, list);
+	return 0;
+}
+
+static void fm_count_ec(struct ubi_scan_info *si, int ec)
+{
+	si->ec_sum += ec;
+	si->ec_count += 1;
+	if (ec > si->max_ec)
+		si->max_ec = ec;
+	if (ec < si->min_ec)
+		si->min_ec = ec;
+}
+
+/* drop @pnum from the volume it was mapped to by the fastmap */
+static void fm_unmap_peb(struct ubi_scan_info *si, int pnum)
+{
+	struct ubi_scan_volume *sv;
+	struct ubi_scan_leb *seb;
+	struct rb_node *rb1, *rb2;
+
+	ubi_rb_for_each_entry(rb1, sv, &si->volumes, rb) {
+		ubi_rb_for_each_entry(rb2, seb, &sv->root, u.rb) {
+			if (seb->pnum == pnum) {
+				rb_erase(&seb->u.rb, &sv->root);
+				sv->leb_count -= 1;
+				kfree(seb);
+				return;
+			}
+		}
+	}
+}
+
+static int fm_has_volume(const struct fm_attach *fa, int vol_id)
+{
+	int i;
+
+	for (i = 0; i < fa->vol_count; i++)
+		if (fa->vol_id[i] == vol_id)
+			return 1;
+	return 0;
+}
+
+/*
+ * The anchor is the PEB of the fastmap super block volume with the highest
+ * sequence number among the first %UBI_FM_MAX_START PEBs.
+ */
+static int fm_find_anchor(struct ubi_device *ubi, struct fm_attach *fa)
+{
+	unsigned long long sqnum, best = 0;
+	int pnum, err, anchor = -1;
+
+	for (pnum = 0; pnum < UBI_FM_MAX_START && pnum < ubi->peb_count;
+	     pnum++) {
+		if (ubi_io_is_bad(ubi, pnum))
+			continue;
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, fa->ech, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, fa->vh, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		if (be32_to_cpu(fa->vh->vol_id) != UBI_FM_SB_VOLUME_ID)
+			continue;
+
+		sqnum = be64_to_cpu(fa->vh->sqnum);
+		if (anchor < 0 || sqnum > best) {
+			anchor = pnum;
+			best = sqnum;
+		}
+	}
+
+	return anchor;
+}
+
+/*
+ * Read the super block at @anchor and all fastmap blocks behind it, check
+ * the data CRC. On success the fastmap data is returned in @raw and the
+ * blocks are recorded in @ubi.
+ */
+static int fm_read(struct ubi_device *ubi, struct fm_attach *fa, int anchor,
+		   void **raw, int *size)
+{
+	struct ubi_fm_sb *fmsb;
+	int i, pnum, used, vol_id, fm_size, err;
+	uint32_t crc;
+	void *buf;
+
+	fmsb = kmalloc(sizeof(struct ubi_fm_sb), GFP_KERNEL);
+	if (!fmsb)
+		return -ENOMEM;
+
+	err = ubi_io_read_data(ubi, fmsb, anchor, 0, sizeof(struct ubi_fm_sb));
+	if (err && err != UBI_IO_BITFLIPS)
+		goto out_bad;
+
+	if (be32_to_cpu(fmsb->magic) != UBI_FM_SB_MAGIC) {
+		ubi_err("bad fastmap super block magic at PEB %d", anchor);
+		goto out_bad;
+	}
+	if (fmsb->version < 1 || fmsb->version > UBI_FM_FMT_VERSION) {
+		ubi_err("unsupported fastmap version %d", fmsb->version);
+		goto out_bad;
+	}
+
+	used = be32_to_cpu(fmsb->used_blocks);
+	if (used < 1 || used > UBI_FM_MAX_BLOCKS ||
+	    be32_to_cpu(fmsb->block_loc[0]) != anchor) {
+		ubi_err("bad fastmap super block at PEB %d", anchor);
+		goto out_bad;
+	}
+
+	fm_size = used * ubi->leb_size;
+	buf = vmalloc(fm_size);
+	if (!buf) {
+		kfree(fmsb);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < used; i++) {
+		pnum = be32_to_cpu(fmsb->block_loc[i]);
+		if (pnum < 0 || pnum >= ubi->peb_count)
+			goto out_bad_buf;
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, fa->ech, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out_bad_buf;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, fa->vh, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out_bad_buf;
+
+		vol_id = be32_to_cpu(fa->vh->vol_id);
+		if (vol_id != (i ? UBI_FM_DATA_VOLUME_ID :
+				   UBI_FM_SB_VOLUME_ID)) {
+			ubi_err("PEB %d is not part of the fastmap", pnum);
+			goto out_bad_buf;
+		}
+
+		if (be64_to_cpu(fa->vh->sqnum) > fa->si->max_sqnum)
+			fa->si->max_sqnum = be64_to_cpu(fa->vh->sqnum);
+
+		err = ubi_io_read_data(ubi, buf + i * ubi->leb_size, pnum, 0,
+				       ubi->leb_size);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out_bad_buf;
+
+		ubi->fm_pnum[i] = pnum;
+		ubi->fm_ec[i] = be64_to_cpu(fa->ech->ec);
+	}
+
+	kfree(fmsb);
+	fmsb = buf;
+	crc = be32_to_cpu(fmsb->data_crc);
+	fmsb->data_crc = 0;
+	if (crc32(UBI_CRC32_INIT, buf, fm_size) != crc) {
+		ubi_err("fastmap data CRC mismatch");
+		vfree(buf);
+		return FM_BAD;
+	}
+
+	ubi->fm_blocks = used;
+	*raw = buf;
+	*size = fm_size;
+	return 0;
+
+out_bad_buf:
+	vfree(buf);
+out_bad:
+	kfree(fmsb);
+	return FM_BAD;
+}
+
+/*
+ * Take one of the free, used, scrub or erase lists of the fastmap. Free and
+ * erase PEBs go straight to the scanning information, used ones wait for
+ * the EBA tables.
+ */
+static int fm_take_list(struct ubi_device *ubi, struct fm_attach *fa,
+			const struct ubi_fm_ec *fec, int count, int state)
+{
+	int i, pnum, ec, err;
+
+	for (i = 0; i < count; i++) {
+		pnum = be32_to_cpu(fec[i].pnum);
+		ec = be32_to_cpu(fec[i].ec);
+		if (pnum < 0 || pnum >= ubi->peb_count || fa->seen[pnum] ||
+		    ec < 0) {
+			ubi_err("bad PEB %d in the fastmap lists", pnum);
+			return FM_BAD;
+		}
+
+		fa->seen[pnum] = state;
+		fa->ec[pnum] = ec;
+		fm_count_ec(fa->si, ec);
+
+		err = 0;
+		if (state == FM_FREE)
+			err = fm_add_to_list(pnum, ec, &fa->si->free);
+		else if (state == FM_ERASE)
+			err = fm_add_to_list(pnum, ec, &fa->si->erase);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/*
+ * Map the LEBs of one volume. The fastmap does not carry the VID headers,
+ * a header is made up from the volume record so that the scanning code can
+ * be used as is. Its sequence number is 0, so a copy found in a pool wins.
+ */
+static int fm_take_volume(struct ubi_device *ubi, struct fm_attach *fa,
+			  const struct ubi_fm_volhdr *fmvhdr,
+			  const struct ubi_fm_eba *fm_eba)
+{
+	struct ubi_vid_hdr *vh = fa->vh;
+	int j, pnum, vol_id, err;
+	int reserved = be32_to_cpu(fm_eba->reserved_pebs);
+
+	vol_id = be32_to_cpu(fmvhdr->vol_id);
+	fa->vol_id[fa->vol_count++] = vol_id;
+
+	memset(vh, 0, sizeof(struct ubi_vid_hdr));
+	vh->vol_id = fmvhdr->vol_id;
+	vh->data_pad = fmvhdr->data_pad;
+	if (fmvhdr->vol_type == UBI_STATIC_VOLUME) {
+		vh->vol_type = UBI_VID_STATIC;
+		vh->used_ebs = fmvhdr->used_ebs;
+		vh->data_size = fmvhdr->last_eb_bytes;
+	} else
+		vh->vol_type = UBI_VID_DYNAMIC;
+	if (vol_id == UBI_LAYOUT_VOLUME_ID)
+		vh->compat = UBI_LAYOUT_VOLUME_COMPAT;
+
+	for (j = 0; j < reserved; j++) {
+		pnum = be32_to_cpu(fm_eba->pnum[j]);
+		if (pnum < 0)
+			continue;
+
+		if (pnum >= ubi->peb_count || (fa->seen[pnum] != FM_USED &&
+		    fa->seen[pnum] != FM_USED_SCRUB)) {
+			ubi_err("PEB %d of LEB %d:%d is not a used PEB",
+				pnum, vol_id, j);
+			return FM_BAD;
+		}
+
+		vh->lnum = cpu_to_be32(j);
+		err = ubi_scan_add_used(ubi, fa->si, pnum, fa->ec[pnum], vh,
+					fa->seen[pnum] == FM_USED_SCRUB);
+		if (err)
+			return err == -ENOMEM ? err : FM_BAD;
+		fa->seen[pnum] = FM_MAPPED;
+	}
+
+	return 0;
+}
+
+/*
+ * Pool PEBs were handed out after the fastmap was written, their headers
+ * tell what they hold now.
+ */
+static int fm_scan_pool(struct ubi_device *ubi, struct fm_attach *fa,
+			const struct ubi_fm_scan_pool *pool)
+{
+	struct ubi_scan_volume *sv;
+	struct ubi_scan_leb *seb;
+	int i, pnum, ec, vol_id, lnum, mapped, scrub, err;
+	int size = be16_to_cpu(pool->size);
+
+	for (i = 0; i < size; i++) {
+		pnum = be32_to_cpu(pool->pebs[i]);
+		if (pnum < 0 || pnum >= ubi->peb_count ||
+		    (fa->seen[pnum] != FM_UNSEEN &&
+		     fa->seen[pnum] != FM_MAPPED)) {
+			ubi_err("bad PEB %d in the fastmap pool", pnum);
+			return FM_BAD;
+		}
+		if (ubi_io_is_bad(ubi, pnum))
+			return FM_BAD;
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, fa->ech, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			return FM_BAD;
+		scrub = err == UBI_IO_BITFLIPS;
+		ec = be64_to_cpu(fa->ech->ec);
+
+		mapped = fa->seen[pnum] == FM_MAPPED;
+		if (!mapped)
+			fm_count_ec(fa->si, ec);
+		fa->seen[pnum] = FM_POOL;
+		ubi->fm_state[pnum] = UBI_FM_PEB_POOL;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, fa->vh, 0);
+		if (err == UBI_IO_PEB_FREE) {
+			if (mapped)
+				fm_unmap_peb(fa->si, pnum);
+			err = fm_add_to_list(pnum, ec, &fa->si->free);
+			if (err)
+				return err;
+			continue;
+		}
+		if (err && err != UBI_IO_BITFLIPS)
+			return FM_BAD;
+		scrub |= err == UBI_IO_BITFLIPS;
+
+		vol_id = be32_to_cpu(fa->vh->vol_id);
+		lnum = be32_to_cpu(fa->vh->lnum);
+		if (vol_id == UBI_FM_SB_VOLUME_ID ||
+		    vol_id == UBI_FM_DATA_VOLUME_ID) {
+			/* a left over of an older fastmap */
+			if (mapped)
+				return FM_BAD;
+			err = fm_add_to_list(pnum, ec, &fa->si->erase);
+			if (err)
+				return err;
+			continue;
+		}
+
+		if (!fm_has_volume(fa, vol_id)) {
+			ubi_err("PEB %d in the pool belongs to unknown volume %d",
+				pnum, vol_id);
+			return FM_BAD;
+		}
+
+		sv = ubi_scan_find_sv(fa->si, vol_id);
+		seb = sv ? ubi_scan_find_seb(sv, lnum) : NULL;
+		if (mapped) {
+			/* written before the fastmap, nothing changed */
+			if (!seb || seb->pnum != pnum)
+				return FM_BAD;
+			seb->sqnum = be64_to_cpu(fa->vh->sqnum);
+			seb->scrub |= scrub;
+			continue;
+		}
+
+		err = ubi_scan_add_used(ubi, fa->si, pnum, ec, fa->vh, scrub);
+		if (err)
+			return err == -ENOMEM ? err : FM_BAD;
+	}
+
+	return 0;
+}
+
+/* check the lists and the EBA tables against each other and fill @fa->si */
+static int fm_parse(struct ubi_device *ubi, struct fm_attach *fa,
+		    void *raw, int fm_size)
+{
+	struct ubi_scan_info *si = fa->si;
+	struct ubi_fm_hdr *fmhdr;
+	struct ubi_fm_scan_pool *fmpl1, *fmpl2;
+	struct ubi_fm_volhdr *fmvhdr;
+	struct ubi_fm_eba *fm_eba;
+	struct ubi_scan_leb *seb;
+	int i, pnum, count, reserved, unseen, err;
+	int pos = sizeof(struct ubi_fm_sb);
+	static const int states[] = { FM_FREE, FM_USED, FM_USED_SCRUB,
+				      FM_ERASE };
+	int counts[4];
+
+	fmhdr = raw + pos;
+	pos += sizeof(struct ubi_fm_hdr);
+	fmpl1 = raw + pos;
+	pos += sizeof(struct ubi_fm_scan_pool);
+	fmpl2 = raw + pos;
+	pos += sizeof(struct ubi_fm_scan_pool);
+	if (pos > fm_size || be32_to_cpu(fmhdr->magic) != UBI_FM_HDR_MAGIC ||
+	    be32_to_cpu(fmpl1->magic) != UBI_FM_POOL_MAGIC ||
+	    be32_to_cpu(fmpl2->magic) != UBI_FM_POOL_MAGIC) {
+		ubi_err("bad fastmap header");
+		return FM_BAD;
+	}
+	if (be16_to_cpu(fmpl1->size) > UBI_FM_MAX_POOL_SIZE ||
+	    be16_to_cpu(fmpl2->size) > UBI_FM_MAX_POOL_SIZE) {
+		ubi_err("bad fastmap pool size");
+		return FM_BAD;
+	}
+
+	counts[0] = be32_to_cpu(fmhdr->free_peb_count);
+	counts[1] = be32_to_cpu(fmhdr->used_peb_count);
+	counts[2] = be32_to_cpu(fmhdr->scrub_peb_count);
+	counts[3] = be32_to_cpu(fmhdr->erase_peb_count);
+	for (i = 0; i < ARRAY_SIZE(counts); i++) {
+		count = counts[i];
+		if (count < 0 || count > ubi->peb_count ||
+		    pos + count * (int)sizeof(struct ubi_fm_ec) > fm_size)
+			return FM_BAD;
+
+		err = fm_take_list(ubi, fa, raw + pos, count, states[i]);
+		if (err)
+			return err;
+		pos += count * sizeof(struct ubi_fm_ec);
+	}
+
+	si->bad_peb_count = be32_to_cpu(fmhdr->bad_peb_count);
+	if (si->bad_peb_count < 0 || si->bad_peb_count > ubi->peb_count)
+		return FM_BAD;
+
+	for (i = 0; i < ubi->fm_blocks; i++) {
+		pnum = ubi->fm_pnum[i];
+		if (fa->seen[pnum]) {
+			ubi_err("fastmap PEB %d is listed in the fastmap", pnum);
+			return FM_BAD;
+		}
+		fa->seen[pnum] = FM_SELF;
+	}
+
+	count = be32_to_cpu(fmhdr->vol_count);
+	if (count < 0 || count > UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT)
+		return FM_BAD;
+
+	for (i = 0; i < count; i++) {
+		fmvhdr = raw + pos;
+		pos += sizeof(struct ubi_fm_volhdr);
+		fm_eba = raw + pos;
+		pos += sizeof(struct ubi_fm_eba);
+		if (pos > fm_size ||
+		    be32_to_cpu(fmvhdr->magic) != UBI_FM_VHDR_MAGIC ||
+		    be32_to_cpu(fm_eba->magic) != UBI_FM_EBA_MAGIC) {
+			ubi_err("bad fastmap volume header");
+			return FM_BAD;
+		}
+
+		reserved = be32_to_cpu(fm_eba->reserved_pebs);
+		if (reserved < 0 || reserved > ubi->peb_count ||
+		    pos + reserved * (int)sizeof(__be32) > fm_size)
+			return FM_BAD;
+		pos += reserved * sizeof(__be32);
+
+		err = fm_take_volume(ubi, fa, fmvhdr, fm_eba);
+		if (err)
+			return err;
+	}
+
+	err = fm_scan_pool(ubi, fa, fmpl1);
+	if (!err)
+		err = fm_scan_pool(ubi, fa, fmpl2);
+	if (err)
+		return err;
+
+	/* every good PEB has to be accounted for exactly once */
+	unseen = 0;
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		if (fa->seen[pnum] == FM_USED ||
+		    fa->seen[pnum] == FM_USED_SCRUB) {
+			ubi_err("used PEB %d is not mapped", pnum);
+			return FM_BAD;
+		}
+		if (fa->seen[pnum] == FM_UNSEEN)
+			unseen++;
+	}
+	if (unseen != si->bad_peb_count) {
+		ubi_err("fastmap accounts for %d of %d PEBs",
+			ubi->peb_count - unseen + si->bad_peb_count,
+			ubi->peb_count);
+		return FM_BAD;
+	}
+
+	/*
+	 * Whatever the fastmap itself says has to be erased may be erased
+	 * without invalidating it, the kernel would erase it as well.
+	 */
+	list_for_each_entry(seb, &si->erase, u.list)
+		if (ubi->fm_state[seb->pnum] == UBI_FM_PEB_OTHER)
+			ubi->fm_state[seb->pnum] = UBI_FM_PEB_ERASE;
+	list_for_each_entry(seb, &si->corr, u.list)
+		if (ubi->fm_state[seb->pnum] == UBI_FM_PEB_OTHER)
+			ubi->fm_state[seb->pnum] = UBI_FM_PEB_ERASE;
+
+	return 0;
+}
+
+/**
+ * ubi_scan_fastmap - attach from the on-flash fastmap.
+ * @ubi: UBI device description object
+ *
+ * This function looks for a fastmap and builds the same scanning information
+ * 'ubi_scan()' would. Returns %NULL if there is no usable fastmap, in which
+ * case the device has to be scanned, and an error pointer if memory ran out.
+ */
+struct ubi_scan_info *ubi_scan_fastmap(struct ubi_device *ubi)
+{
+	struct fm_attach *fa;
+	struct ubi_scan_info *si;
+	int anchor = -1, fm_size, err = -ENOMEM;
+	void *raw = NULL;
+
+	fa = kzalloc(sizeof(struct fm_attach), GFP_KERNEL);
+	if (!fa)
+		return ERR_PTR(-ENOMEM);
+
+	si = kzalloc(sizeof(struct ubi_scan_info), GFP_KERNEL);
+	if (!si)
+		goto out_fa;
+
+	INIT_LIST_HEAD(&si->corr);
+	INIT_LIST_HEAD(&si->free);
+	INIT_LIST_HEAD(&si->erase);
+	INIT_LIST_HEAD(&si->alien);
+	si->volumes = RB_ROOT;
+	si->min_ec = UBI_MAX_ERASECOUNTER;
+	fa->si = si;
+
+	fa->ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	fa->vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	fa->seen = kzalloc(ubi->peb_count, GFP_KERNEL);
+	fa->ec = kmalloc(ubi->peb_count * sizeof(int), GFP_KERNEL);
+	ubi->fm_state = kzalloc(ubi->peb_count, GFP_KERNEL);
+	if (!fa->ech || !fa->vh || !fa->seen || !fa->ec || !ubi->fm_state)
+		goto out;
+
+	anchor = fm_find_anchor(ubi, fa);
+	if (anchor < 0) {
+		ubi_msg("no fastmap found");
+		err = FM_BAD;
+		goto out;
+	}
+
+	err = fm_read(ubi, fa, anchor, &raw, &fm_size);
+	if (!err)
+		err = fm_parse(ubi, fa, raw, fm_size);
+	if (err)
+		goto out;
+
+	/* the scanning information must not have unknown erase counters */
+	if (si->ec_count) {
+		do_div(si->ec_sum, si->ec_count);
+		si->mean_ec = si->ec_sum;
+	}
+
+	ubi->fm_valid = 1;
+	ubi_msg("fastmap at PEB %d, %d PEBs, %d volumes", anchor,
+		ubi->fm_blocks, fa->vol_count);
+
+	vfree(raw);
+	kfree(fa->ec);
+	kfree(fa->seen);
+	ubi_free_vid_hdr(ubi, fa->vh);
+	kfree(fa->ech);
+	kfree(fa);
+	return si;
+
+out:
+	if (err == FM_BAD && anchor >= 0)
+		ubi_warn("bad fastmap, falling back to scanning");
+	vfree(raw);
+	kfree(fa->ec);
+	kfree(fa->seen);
+	ubi_free_vid_hdr(ubi, fa->vh);
+	kfree(fa->ech);
+	kfree(ubi->fm_state);
+	ubi->fm_state = NULL;
+	ubi->fm_blocks = 0;
+	ubi_scan_destroy_si(si);
+out_fa:
+	kfree(fa);
+	return err == -ENOMEM ? ERR_PTR(err) : NULL;
+}
+
+/*
+ * Erase the anchor so that nobody attaches from a fastmap which no longer
+ * describes the device. The fastmap PEBs stay out of WL until the next
+ * 'ubi_update_fastmap()' or detach, a scan deletes the rest of them.
+ */
+static int fm_invalidate(struct ubi_device *ubi, int pnum)
+{
+	struct ubi_ec_hdr *ech;
+	int anchor = ubi->fm_pnum[0], err;
+
+	ubi->fm_valid = 0;
+	ubi_msg("PEB %d changes, dropping the fastmap at PEB %d", pnum, anchor);
+
+	err = ubi_io_sync_erase(ubi, anchor, 0);
+	if (err < 0) {
+		ubi_err("cannot erase the fastmap anchor, error %d", err);
+		ubi_ro_mode(ubi);
+		return -EROFS;
+	}
+	ubi->fm_ec[0] += err;
+
+	/* without an EC header the PEB is just empty, no harm done */
+	ech = kzalloc(ubi->ec_hdr_alsize, GFP_NOFS);
+	if (ech) {
+		ech->ec = cpu_to_be64(ubi->fm_ec[0]);
+		ubi_io_write_ec_hdr(ubi, anchor, ech);
+		kfree(ech);
+	}
+
+	return 0;
+}
+
+/**
+ * ubi_fastmap_check_write - keep the on-flash fastmap truthful.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock about to be changed
+ * @offset: offset of the write, %-1 for an erasure
+ *
+ * Called by the I/O unit before each write and erasure. If the change is not
+ * one the fastmap allows for, the fastmap is invalidated first. Returns zero
+ * or a negative error code if the device could not be kept consistent.
+ */
+int ubi_fastmap_check_write(struct ubi_device *ubi, int pnum, int offset)
+{
+	int state;
+
+	if (!ubi->fm_valid)
+		return 0;
+
+	state = ubi->fm_state[pnum];
+	if (state == UBI_FM_PEB_POOL)
+		return 0;
+	/* erasing and a new EC header leave an erase PEB unmapped */
+	if (state == UBI_FM_PEB_ERASE && offset < ubi->vid_hdr_aloffset)
+		return 0;
+
+	return fm_invalidate(ubi, pnum);
+}
+
+/* size of the fastmap as the kernel computes it, it rejects any other */
+static int fm_calc_size(const struct ubi_device *ubi)
+{
+	int size;
+
+	size = sizeof(struct ubi_fm_sb) + sizeof(struct ubi_fm_hdr) +
+	       2 * sizeof(struct ubi_fm_scan_pool) +
+	       ubi->peb_count * sizeof(struct ubi_fm_ec) +
+	       sizeof(struct ubi_fm_eba) + ubi->peb_count * sizeof(__be32) +
+	       UBI_MAX_VOLUMES * sizeof(struct ubi_fm_volhdr);
+
+	return roundup(size, ubi->leb_size);
+}
+
+/* hand all fastmap PEBs back to WL, the anchor first */
+static int fm_release(struct ubi_device *ubi)
+{
+	int i, err = 0;
+
+	for (i = 0; i < ubi->fm_blocks; i++) {
+		err = ubi_wl_put_fm_peb(ubi, ubi->fm_pnum[i], ubi->fm_ec[i]);
+		if (err)
+			break;
+	}
+
+	spin_lock(&ubi->volumes_lock);
+	ubi->avail_pebs += i;
+	ubi->rsvd_pebs -= i;
+	spin_unlock(&ubi->volumes_lock);
+
+	ubi->fm_blocks -= i;
+	memmove(ubi->fm_pnum, ubi->fm_pnum + i, ubi->fm_blocks * sizeof(int));
+	memmove(ubi->fm_ec, ubi->fm_ec + i, ubi->fm_blocks * sizeof(int));
+	return err;
+}
+
+/* take the PEBs for a new fastmap of @used blocks, erased, with EC headers */
+static int fm_get_pebs(struct ubi_device *ubi, struct ubi_ec_hdr *ech,
+		       int used)
+{
+	int i, pnum, ec, err;
+
+	spin_lock(&ubi->volumes_lock);
+	if (ubi->avail_pebs < used) {
+		spin_unlock(&ubi->volumes_lock);
+		ubi_err("the fastmap needs %d PEBs, %d available", used,
+			ubi->avail_pebs);
+		return -ENOSPC;
+	}
+	spin_unlock(&ubi->volumes_lock);
+
+	for (i = 0; i < used; i++) {
+		pnum = ubi_wl_get_fm_peb(ubi, i ? ubi->peb_count :
+					 UBI_FM_MAX_START, &ec);
+		if (pnum < 0) {
+			ubi_err("no free PEB for the fastmap %s",
+				i ? "data" : "anchor");
+			return pnum;
+		}
+
+		spin_lock(&ubi->volumes_lock);
+		ubi->avail_pebs -= 1;
+		ubi->rsvd_pebs += 1;
+		spin_unlock(&ubi->volumes_lock);
+		ubi->fm_pnum[i] = pnum;
+		ubi->fm_ec[i] = ec;
+		ubi->fm_blocks = i + 1;
+
+		err = ubi_io_sync_erase(ubi, pnum, 0);
+		if (err < 0)
+			return err;
+		ubi->fm_ec[i] += err;
+
+		memset(ech, 0, ubi->ec_hdr_alsize);
+		ech->ec = cpu_to_be64(ubi->fm_ec[i]);
+		err = ubi_io_write_ec_hdr(ubi, pnum, ech);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/* lay the WL and EBA state out in @raw, returns the bytes used */
+static int fm_fill(struct ubi_device *ubi, void *raw, int fm_size,
+		   unsigned long long sqnum)
+{
+	struct ubi_fm_sb *fmsb = raw;
+	struct ubi_fm_hdr *fmhdr;
+	struct ubi_fm_scan_pool *fmpl;
+	struct ubi_fm_volhdr *fmvhdr;
+	struct ubi_fm_eba *fm_eba;
+	struct ubi_volume *vol;
+	int i, j, n, pos, pool_size, vol_count = 0;
+
+	memset(raw, 0, fm_size);
+
+	fmsb->magic = cpu_to_be32(UBI_FM_SB_MAGIC);
+	fmsb->version = UBI_FM_FMT_VERSION;
+	fmsb->used_blocks = cpu_to_be32(ubi->fm_blocks);
+	fmsb->sqnum = cpu_to_be64(sqnum);
+	for (i = 0; i < ubi->fm_blocks; i++) {
+		fmsb->block_loc[i] = cpu_to_be32(ubi->fm_pnum[i]);
+		fmsb->block_ec[i] = cpu_to_be32(ubi->fm_ec[i]);
+	}
+	pos = sizeof(struct ubi_fm_sb);
+
+	fmhdr = raw + pos;
+	fmhdr->magic = cpu_to_be32(UBI_FM_HDR_MAGIC);
+	fmhdr->bad_peb_count = cpu_to_be32(ubi->bad_peb_count);
+	pos += sizeof(struct ubi_fm_hdr);
+
+	/* empty pools, sized the way the kernel sizes them */
+	pool_size = ubi->peb_count / 100 * 5;
+	if (pool_size > UBI_FM_MAX_POOL_SIZE)
+		pool_size = UBI_FM_MAX_POOL_SIZE;
+	if (pool_size < UBI_FM_MIN_POOL_SIZE)
+		pool_size = UBI_FM_MIN_POOL_SIZE;
+
+	fmpl = raw + pos;
+	fmpl->magic = cpu_to_be32(UBI_FM_POOL_MAGIC);
+	fmpl->max_size = cpu_to_be16(pool_size);
+	pos += sizeof(struct ubi_fm_scan_pool);
+
+	fmpl = raw + pos;
+	fmpl->magic = cpu_to_be32(UBI_FM_POOL_MAGIC);
+	fmpl->max_size = cpu_to_be16(UBI_FM_WL_POOL_SIZE);
+	pos += sizeof(struct ubi_fm_scan_pool);
+
+	/* nothing is pending for erasure, WL works run synchronously here */
+	n = ubi_wl_fm_list(ubi, UBI_FM_LIST_FREE, NULL) +
+	    ubi_wl_fm_list(ubi, UBI_FM_LIST_USED, NULL) +
+	    ubi_wl_fm_list(ubi, UBI_FM_LIST_SCRUB, NULL);
+	if (pos + n * (int)sizeof(struct ubi_fm_ec) > fm_size)
+		return -ENOSPC;
+
+	n = ubi_wl_fm_list(ubi, UBI_FM_LIST_FREE, raw + pos);
+	fmhdr->free_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+	n = ubi_wl_fm_list(ubi, UBI_FM_LIST_USED, raw + pos);
+	fmhdr->used_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+	n = ubi_wl_fm_list(ubi, UBI_FM_LIST_SCRUB, raw + pos);
+	fmhdr->scrub_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+
+	for (i = 0; i < UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT; i++) {
+		vol = ubi->volumes[i];
+		if (!vol)
+			continue;
+
+		if (pos + (int)(sizeof(struct ubi_fm_volhdr) +
+		    sizeof(struct ubi_fm_eba)) +
+		    vol->reserved_pebs * (int)sizeof(__be32) > fm_size)
+			return -ENOSPC;
+
+		fmvhdr = raw + pos;
+		fmvhdr->magic = cpu_to_be32(UBI_FM_VHDR_MAGIC);
+		fmvhdr->vol_id = cpu_to_be32(vol->vol_id);
+		fmvhdr->vol_type = vol->vol_type;
+		fmvhdr->used_ebs = cpu_to_be32(vol->used_ebs);
+		fmvhdr->data_pad = cpu_to_be32(vol->data_pad);
+		fmvhdr->last_eb_bytes = cpu_to_be32(vol->last_eb_bytes);
+		pos += sizeof(struct ubi_fm_volhdr);
+
+		fm_eba = raw + pos;
+		fm_eba->magic = cpu_to_be32(UBI_FM_EBA_MAGIC);
+		fm_eba->reserved_pebs = cpu_to_be32(vol->reserved_pebs);
+		for (j = 0; j < vol->reserved_pebs; j++)
+			fm_eba->pnum[j] = cpu_to_be32(vol->eba_tbl[j]);
+		pos += sizeof(struct ubi_fm_eba) +
+		       vol->reserved_pebs * sizeof(__be32);
+		vol_count++;
+	}
+	fmhdr->vol_count = cpu_to_be32(vol_count);
+
+	fmsb->data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, raw, fm_size));
+	return pos;
+}
+
+/**
+ * ubi_update_fastmap - write a new fastmap.
+ * @ubi: UBI device description object
+ *
+ * The old fastmap, if any, is dropped and its PEBs go back to WL, then the
+ * current state is written to fresh PEBs, the anchor last. Returns zero in
+ * case of success and a negative error code in case of failure.
+ */
+int ubi_update_fastmap(struct ubi_device *ubi)
+{
+	struct ubi_vid_hdr *vh;
+	struct ubi_ec_hdr *ech;
+	unsigned long long sqnum;
+	int i, fm_size, used, err = -ENOMEM;
+	void *raw;
+
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	fm_size = fm_calc_size(ubi);
+	used = fm_size / ubi->leb_size;
+	if (used > UBI_FM_MAX_BLOCKS)
+		return -ENOSPC;
+
+	if (!ubi->fm_state) {
+		ubi->fm_state = kzalloc(ubi->peb_count, GFP_KERNEL);
+		if (!ubi->fm_state)
+			return -ENOMEM;
+	}
+
+	raw = vmalloc(fm_size);
+	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!raw || !ech || !vh)
+		goto out_free;
+
+	ubi->fm_valid = 0;
+	err = fm_release(ubi);
+	if (err)
+		goto out_free;
+
+	err = fm_get_pebs(ubi, ech, used);
+	if (err)
+		goto out_release;
+
+	spin_lock(&ubi->ltree_lock);
+	sqnum = ubi->global_sqnum;
+	ubi->global_sqnum += used;
+	spin_unlock(&ubi->ltree_lock);
+
+	err = fm_fill(ubi, raw, fm_size, sqnum);
+	if (err < 0)
+		goto out_release;
+
+	/* the anchor goes last, a torn write leaves no fastmap behind */
+	for (i = used - 1; i >= 0; i--) {
+		memset(vh, 0, sizeof(struct ubi_vid_hdr));
+		vh->vol_type = UBI_VID_DYNAMIC;
+		vh->vol_id = cpu_to_be32(i ? UBI_FM_DATA_VOLUME_ID :
+					     UBI_FM_SB_VOLUME_ID);
+		vh->compat = UBI_COMPAT_DELETE;
+		vh->lnum = cpu_to_be32(i);
+		vh->sqnum = cpu_to_be64(sqnum + i);
+
+		err = ubi_io_write_vid_hdr(ubi, ubi->fm_pnum[i], vh);
+		if (!err)
+			err = ubi_io_write_data(ubi, raw + i * ubi->leb_size,
+						ubi->fm_pnum[i], 0,
+						ubi->leb_size);
+		if (err)
+			goto out_release;
+	}
+
+	memset(ubi->fm_state, UBI_FM_PEB_OTHER, ubi->peb_count);
+	ubi->fm_valid = 1;
+	ubi_msg("fastmap written to PEB %d, %d PEBs", ubi->fm_pnum[0], used);
+	err = 0;
+	goto out_free;
+
+out_release:
+	ubi_err("cannot write the fastmap, error %d", err);
+	fm_release(ubi);
+out_free:
+	ubi_free_vid_hdr(ubi, vh);
+	kfree(ech);
+	vfree(raw);
+	return err;
+}
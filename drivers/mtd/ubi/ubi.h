@@ -106,6 +106,27 @@ enum {
 	UBI_IO_BITFLIPS
 };
 
+/*
+ * What may happen to a physical eraseblock without invalidating the on-flash
+ * fastmap.
+ *
+ * UBI_FM_PEB_OTHER: nothing, erasing or writing it invalidates the fastmap
+ * UBI_FM_PEB_ERASE: it may be erased and get a new erase counter header
+ * UBI_FM_PEB_POOL: anything, it is in a fastmap pool and gets scanned
+ */
+enum {
+	UBI_FM_PEB_OTHER = 0,
+	UBI_FM_PEB_ERASE,
+	UBI_FM_PEB_POOL
+};
+
+/* The WL trees 'ubi_wl_fm_list()' reports */
+enum {
+	UBI_FM_LIST_FREE,
+	UBI_FM_LIST_USED,
+	UBI_FM_LIST_SCRUB
+};
+
 /**
  * struct ubi_wl_entry - wear-leveling entry.
  * @rb: link in the corresponding RB-tree
@@ -319,6 +340,12 @@ struct ubi_wl_entry;
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
  *
+ * @fm_blocks: number of PEBs held by the fastmap, they are not in the WL trees
+ * @fm_pnum: PEB numbers of the fastmap, the anchor first
+ * @fm_ec: erase counters of the fastmap PEBs
+ * @fm_valid: the on-flash fastmap still describes the device
+ * @fm_state: per PEB, which changes keep the fastmap valid (%UBI_FM_PEB_*)
+ *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
  * @peb_size: physical eraseblock size
@@ -401,6 +428,15 @@ struct ubi_device {
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	/* Fastmap stuff */
+	int fm_blocks;
+	int fm_pnum[UBI_FM_MAX_BLOCKS];
+	int fm_ec[UBI_FM_MAX_BLOCKS];
+	int fm_valid;
+	unsigned char *fm_state;
+#endif
+
 	/* I/O unit's stuff */
 	long long flash_size;
 	int peb_count;
@@ -505,6 +541,11 @@ int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
 int ubi_thread(void *u);
+#ifdef CONFIG_MTD_UBI_FASTMAP
+int ubi_wl_get_fm_peb(struct ubi_device *ubi, int max_pnum, int *ec);
+int ubi_wl_put_fm_peb(struct ubi_device *ubi, int pnum, int ec);
+int ubi_wl_fm_list(struct ubi_device *ubi, int list, struct ubi_fm_ec *fec);
+#endif
 
 /* io.c */
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
@@ -523,6 +564,13 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
 
+/* fastmap.c */
+#ifdef CONFIG_MTD_UBI_FASTMAP
+struct ubi_scan_info *ubi_scan_fastmap(struct ubi_device *ubi);
+int ubi_fastmap_check_write(struct ubi_device *ubi, int pnum, int offset);
+int ubi_update_fastmap(struct ubi_device *ubi);
+#endif
+
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset);
 int ubi_detach_mtd_dev(int ubi_num, int anyway);
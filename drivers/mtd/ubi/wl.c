@@ -1452,7 +1452,7 @@ static void cancel_pending(struct ubi_device *ubi)
  */
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 {
-	int err;
+	int err, reserved_pebs;
 	struct rb_node *rb1, *rb2;
 	struct ubi_scan_volume *sv;
 	struct ubi_scan_leb *seb, *tmp;
@@ -1543,14 +1543,19 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 		}
 	}
 
-	if (ubi->avail_pebs < WL_RESERVED_PEBS) {
+	reserved_pebs = WL_RESERVED_PEBS;
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	/* The fastmap PEBs stay out of the WL trees */
+	reserved_pebs += ubi->fm_blocks;
+#endif
+	if (ubi->avail_pebs < reserved_pebs) {
 		ubi_err("no enough physical eraseblocks (%d, need %d)",
-			ubi->avail_pebs, WL_RESERVED_PEBS);
+			ubi->avail_pebs, reserved_pebs);
 		err = -ENOSPC;
 		goto out_free;
 	}
-	ubi->avail_pebs -= WL_RESERVED_PEBS;
-	ubi->rsvd_pebs += WL_RESERVED_PEBS;
+	ubi->avail_pebs -= reserved_pebs;
+	ubi->rsvd_pebs += reserved_pebs;
 
 	/* Schedule wear-leveling if needed */
 	err = ensure_wear_leveling(ubi);
@@ -1568,6 +1573,118 @@ out_free:
 	return err;
 }
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+/**
+ * ubi_wl_get_fm_peb - take a free physical eraseblock for the fastmap.
+ * @ubi: UBI device description object
+ * @max_pnum: only physical eraseblocks below this number qualify
+ * @ec: the erase counter of the physical eraseblock is returned here
+ *
+ * The physical eraseblock leaves the WL unit altogether, it comes back by
+ * means of 'ubi_wl_put_fm_peb()'. The least worn out candidate is picked.
+ * Returns the physical eraseblock number or %-ENOSPC.
+ */
+int ubi_wl_get_fm_peb(struct ubi_device *ubi, int max_pnum, int *ec)
+{
+	struct ubi_wl_entry *e = NULL, *e1;
+	struct rb_node *rb;
+	int pnum;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_rb_for_each_entry(rb, e1, &ubi->free, rb) {
+		if (e1->pnum < max_pnum) {
+			e = e1;
+			break;
+		}
+	}
+	if (!e) {
+		spin_unlock(&ubi->wl_lock);
+		return -ENOSPC;
+	}
+
+	rb_erase(&e->rb, &ubi->free);
+	ubi->lookuptbl[e->pnum] = NULL;
+	spin_unlock(&ubi->wl_lock);
+
+	pnum = e->pnum;
+	*ec = e->ec;
+	kmem_cache_free(ubi_wl_entry_slab, e);
+	return pnum;
+}
+
+/**
+ * ubi_wl_put_fm_peb - return a fastmap physical eraseblock to WL.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to return
+ * @ec: its erase counter
+ *
+ * The physical eraseblock is erased and joins the free tree. Returns zero in
+ * case of success and a negative error code in case of failure.
+ */
+int ubi_wl_put_fm_peb(struct ubi_device *ubi, int pnum, int ec)
+{
+	struct ubi_wl_entry *e;
+
+	e = kmem_cache_alloc(ubi_wl_entry_slab, GFP_NOFS);
+	if (!e)
+		return -ENOMEM;
+
+	e->pnum = pnum;
+	e->ec = ec;
+	ubi->lookuptbl[pnum] = e;
+	return schedule_erase(ubi, e, 0);
+}
+
+static void fm_ec_set(struct ubi_fm_ec *fec, const struct ubi_wl_entry *e)
+{
+	fec->pnum = cpu_to_be32(e->pnum);
+	fec->ec = cpu_to_be32(e->ec);
+}
+
+/**
+ * ubi_wl_fm_list - describe one of the WL trees for the fastmap.
+ * @ubi: UBI device description object
+ * @list: %UBI_FM_LIST_FREE, %UBI_FM_LIST_USED or %UBI_FM_LIST_SCRUB
+ * @fec: where to store the entries, %NULL to only count them
+ *
+ * Protected physical eraseblocks are reported as used. Returns the number of
+ * entries.
+ */
+int ubi_wl_fm_list(struct ubi_device *ubi, int list, struct ubi_fm_ec *fec)
+{
+	struct ubi_wl_prot_entry *pe;
+	struct ubi_wl_entry *e;
+	struct rb_root *root;
+	struct rb_node *rb;
+	int n = 0;
+
+	if (list == UBI_FM_LIST_FREE)
+		root = &ubi->free;
+	else if (list == UBI_FM_LIST_USED)
+		root = &ubi->used;
+	else
+		root = &ubi->scrub;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_rb_for_each_entry(rb, e, root, rb) {
+		if (fec)
+			fm_ec_set(&fec[n], e);
+		n++;
+	}
+
+	if (list == UBI_FM_LIST_USED) {
+		ubi_rb_for_each_entry(rb, pe, &ubi->prot.pnum, rb_pnum) {
+			if (fec)
+				fm_ec_set(&fec[n], pe->e);
+			n++;
+		}
+	}
+	spin_unlock(&ubi->wl_lock);
+
+	return n;
+}
+#endif /* CONFIG_MTD_UBI_FASTMAP */
+
 /**
  * protection_trees_destroy - destroy the protection RB-trees.
  * @ubi: UBI device description object
@@ -16,7 +16,9 @@ static synopGMACdevice	*gmacdev;
 static synopGMACdevice	_gmacdev;
 
 #define NUM_RX_DESCS	PKTBUFSRX
-#define NUM_TX_DESCS	4
+#define NUM_TX_DESCS	16
+#define TX_BUFF_SIZE	2048
+#define TX_TIMEOUT	100	/* ms for a ring slot to come back */
 
 static DmaDesc	_tx_desc[NUM_TX_DESCS];
 static DmaDesc	_rx_desc[NUM_RX_DESCS];
@@ -25,7 +27,13 @@ static DmaDesc	*rx_desc;
 static int	next_tx;
 static int	next_rx;
 
-unsigned char tx_buff[NUM_TX_DESCS * 2048];
+/*
+ * Frames are copied into a slot of their own: the net stack builds the
+ * next frame in NetTxPacket as soon as send returns, long before the DMA
+ * is done with the previous one.
+ */
+static unsigned char tx_buff[NUM_TX_DESCS][TX_BUFF_SIZE]
+	__attribute__ ((aligned(CONFIG_SYS_CACHELINE_SIZE)));
 
 __attribute__((__unused__)) static void jzmac_dump_dma_desc2(DmaDesc *desc)
 {
@@ -282,98 +290,90 @@ static void jzmac_restart_tx_dma(void)
 	}
 }
 
+/*
+ * Queue a frame and return. Completion is only looked at when the ring
+ * wraps around to a slot the DMA still owns.
+ */
 static int jz_send(struct eth_device* dev, void *packet, int length)
 {
-	DmaDesc *desc = tx_desc + next_tx;
-	int ret = 1;
-	int wait_delay = 1000;
+	volatile DmaDesc *desc = tx_desc + next_tx;
+	unsigned char *buf = tx_buff[next_tx];
+	ulong start;
 
 	if (!packet) {
 		printf("jz_send: packet is NULL !\n");
 		return -1;
 	}
+	if (length > TX_BUFF_SIZE)
+		return -1;
 
-	memset(&tx_buff[next_tx * 2048], 0, 2048);
-	memcpy((void *)&tx_buff[next_tx * 2048], packet, length);
-	flush_dcache_all();
+	start = get_timer(0);
+	while (synopGMAC_is_desc_owned_by_dma(desc)) {
+		if (get_timer(start) > TX_TIMEOUT) {
+			printf("jz_send: tx ring stalled, need reload\n");
+			return -1;
+		}
+	}
 
-	/* prepare DMA data */
-	desc->length |= (((length <<DescSize1Shift) & DescSize1Mask)
-			 | ((0 <<DescSize2Shift) & DescSize2Mask));
+	memcpy(buf, packet, length);
+	flush_dcache_range((ulong)buf, (ulong)buf + length);
 
-	desc->buffer1 = virt_to_phys(&tx_buff[next_tx * 2048]);
-//	desc->buffer1 = virt_to_phys(packet);
-	/* ENH_DESC */
-	desc->status |=  (DescTxFirst | DescTxLast | DescTxIntEnable);
-	desc->status |= DescOwnByDma;
+	/* descriptors are uncached, hand over the status word last */
+	desc->length = (length << DescSize1Shift) & DescSize1Mask;
+	desc->buffer1 = virt_to_phys(buf);
+	desc->status = DescTxFirst | DescTxLast |
+		(next_tx == NUM_TX_DESCS - 1 ? TxDescEndOfRing : 0) |
+		DescOwnByDma;
 
-	/* start tx operation*/
 	jzmac_restart_tx_dma();
 
-	/* wait until current desc transfer done */
-#if 1
-	while(--wait_delay && synopGMAC_is_desc_owned_by_dma(desc)) {
-		udelay(100);
-	}
-	/* check if there is error during transmit */
-	if(wait_delay == 0)
-	{
-		printf("error may happen, need reload\n");
-		return -1;
-	}
-#endif
-
-//	printf("send data length: %d\n", length);
-
-//	jzmac_dump_dma_regs(__func__, __LINE__);
-	/* if error occurs, then handle the error */
-
 	next_tx++;
 	if (next_tx >= NUM_TX_DESCS)
 		next_tx = 0;
 
-	return ret;
+	return 1;
 }
 
+/*
+ * Reap every frame the DMA has completed, then kick the RX DMA once for
+ * the whole batch.
+ */
 static int jz_recv(struct eth_device* dev)
 {
 	volatile DmaDesc *desc;
-	int length = -1;
-
-	desc = rx_desc + next_rx;
+	u32 status;
+	int length, count = 0;
 
-	if(!synopGMAC_is_desc_owned_by_dma(desc)) {
-		/* since current desc contains the valid data, now we're going to get the data */
-		length = synopGMAC_get_rx_desc_frame_length(desc->status);
-		/* Pass the packet up to the protocol layers */
-
-#if 0
-		jzmac_dump_arp_reply(NetRxPackets[next_rx], length - 4);
-		jzmac_dump_icmp_reply(NetRxPackets[next_rx], length - 4);
-#endif
+	while (count < NUM_RX_DESCS) {
+		desc = rx_desc + next_rx;
+		status = desc->status;
+		if (status & DescOwnByDma)
+			break;
 
-		// printf("recv length:%d\n", length);
-		//jzmac_dump_dma_regs(__func__, __LINE__);
-#if 0
-		if(length  < 28) {
-			udelay(100);
-			return -1;
-		}
-#endif
-		NetReceive(NetRxPackets[next_rx], length - 4);
-		/* after got data, make sure the dma owns desc to recv data from MII */
+		length = synopGMAC_get_rx_desc_frame_length(status);
+		if (synopGMAC_is_desc_valid(status) &&
+		    (status & (DescRxFirst | DescRxLast)) ==
+		    (DescRxFirst | DescRxLast))
+			NetReceive(NetRxPackets[next_rx], length - 4);
+
+		/*
+		 * The stack may have written into the buffer (ping replies are
+		 * built in place), drop those lines before the DMA refills it.
+		 */
+		invalidate_dcache_range((ulong)NetRxPackets[next_rx],
+					(ulong)NetRxPackets[next_rx] + PKTSIZE_ALIGN);
 		desc->status = DescOwnByDma;
 
-		synopGMAC_resume_dma_rx(gmacdev);
-
-		flush_dcache_all();
-
 		next_rx++;
 		if (next_rx >= NUM_RX_DESCS)
 			next_rx = 0;
+		count++;
 	}
 
-	return length;
+	if (count)
+		synopGMAC_resume_dma_rx(gmacdev);
+
+	return count;
 }
 
 static int jz_init(struct eth_device* dev, bd_t * bd)
@@ -385,12 +385,14 @@ static int jz_init(struct eth_device* dev, bd_t * bd)
 
 	next_tx = 0;
 	next_rx = 0;
-	memset(tx_buff, 0, 2048 * NUM_TX_DESCS);
 
 	printf("jz_init......\n");
 	/* init global pointers */
 	tx_desc = (DmaDesc *)((unsigned long)_tx_desc | 0xa0000000);
 	rx_desc = (DmaDesc *)((unsigned long)_rx_desc | 0xa0000000);
+	/* no dirty cached alias may land on top of the uncached writes */
+	flush_dcache_range_nosync((ulong)_tx_desc, (ulong)(_tx_desc + NUM_TX_DESCS));
+	flush_dcache_range((ulong)_rx_desc, (ulong)(_rx_desc + NUM_RX_DESCS));
 
 	/* reset GMAC, prepare to search phy */
 	if (synopGMAC_reset(gmacdev) < 0) {
@@ -419,6 +421,8 @@ static int jz_init(struct eth_device* dev, bd_t * bd)
 	synopGMAC_check_phy_init(gmacdev);
 	jz47xx_mac_configure();
 	for (i = 0; i <  NUM_TX_DESCS; i++) {
+		/* forget frames left in flight by the last session */
+		tx_desc[i].status = 0;
 		synopGMAC_tx_desc_init_ring(tx_desc + i, i == (NUM_TX_DESCS - 1));
 	}
 
@@ -438,13 +442,16 @@ static int jz_init(struct eth_device* dev, bd_t * bd)
 		curr_desc->timestamplow = 0;
 		curr_desc->timestamphigh = 0;
 
+		/* the DMA must not find stale dirty lines over the buffer */
+		flush_dcache_range_nosync((ulong)NetRxPackets[i],
+					  (ulong)NetRxPackets[i] + PKTSIZE_ALIGN);
+
 		/* start transfer */
 		curr_desc->status = DescOwnByDma;
 	}
+	cache_sync();
 	synopGMACWriteReg((u32 *)gmacdev->DmaBase,DmaRxBaseAddr, virt_to_phys(_rx_desc));
 
-	flush_dcache_all();
-
 #ifdef SYNOP_DEBUG
 	jzmac_dump_all_regs(__func__, __LINE__);
 #endif
@@ -461,8 +468,31 @@ static int jz_init(struct eth_device* dev, bd_t * bd)
 	return 1;
 }
 
+/*
+ * jz_send() does not wait for its frame, let the ring run empty before
+ * the TX DMA is stopped: the last one is often the final TFTP ACK.
+ */
+static void jz_tx_drain(void)
+{
+	ulong start = get_timer(0);
+	int i;
+
+	if (!tx_desc)
+		return;
+
+	for (i = 0; i < NUM_TX_DESCS; i++) {
+		while (synopGMAC_is_desc_owned_by_dma(tx_desc + i)) {
+			if (get_timer(start) > TX_TIMEOUT) {
+				printf("jz_halt: tx ring not drained\n");
+				return;
+			}
+		}
+	}
+}
+
 static void jz_halt(struct eth_device *dev)
 {
+	jz_tx_drain();
 	next_tx = 0;
 	next_rx = 0;
 	synopGMAC_rx_disable(gmacdev);
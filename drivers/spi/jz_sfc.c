@@ -36,6 +36,16 @@
 
 #include "jz_spi.h"
 
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * Called over and over while the flash is busy programming or erasing,
+ * the cloner keeps receiving the next chunk from it.
+ */
+void __weak sfc_busy_hook(void)
+{
+}
+
 static struct jz_spi_support gparams;
 static struct nor_sharing_params pdata;
 
@@ -305,6 +315,76 @@ static int sfc_write_data(unsigned int *data, unsigned int length)
 
 	return 0;
 }
+#ifdef CONFIG_JZ_SFC_DMA
+/* runtime switch, "sfcnor speed" toggles it to compare the two paths */
+int sfc_dma_enable = 1;
+
+static int sfc_can_dma(const void *buf, unsigned int length)
+{
+	if (!sfc_dma_enable || length < SFC_DMA_MIN_LEN)
+		return 0;
+	/* the buffer may not share a cache line with anything else */
+	if (((unsigned long)buf | length) & (ARCH_DMA_MINALIGN - 1))
+		return 0;
+	return 1;
+}
+
+/*
+ * The transfer registers must already be programmed by sfc_set_transfer(),
+ * the controller then moves the data between SFC_DR and memory on its own.
+ */
+static void sfc_dma_start(void *buf, unsigned int length)
+{
+	unsigned long start = (unsigned long)buf;
+	unsigned int tmp;
+
+	/* write back and drop the lines, nothing may be evicted during DMA */
+	flush_dcache_range(start, start + length);
+
+	jz_sfc_writel(virt_to_phys(buf), SFC_MEM_ADDR);
+	tmp = jz_sfc_readl(SFC_GLB);
+	tmp |= OP_MODE;
+	jz_sfc_writel(tmp, SFC_GLB);
+
+	jz_sfc_writel(START, SFC_TRIG);
+}
+
+static int sfc_dma_wait(void *buf, unsigned int length, int dir)
+{
+	unsigned long start = (unsigned long)buf;
+	unsigned int tmp;
+	ulong timebase;
+	int ret = 0;
+
+	timebase = get_timer(0);
+	while (!(jz_sfc_readl(SFC_SR) & END)) {
+		sfc_busy_hook();
+		if (get_timer(timebase) > SFC_DMA_TIMEOUT) {
+			printf("sfc dma %s timeout\n", dir ? "write" : "read");
+			jz_sfc_writel(STOP, SFC_TRIG);
+			ret = -1;
+			break;
+		}
+	}
+	jz_sfc_writel(CLR_END, SFC_SCR);
+
+	tmp = jz_sfc_readl(SFC_GLB);
+	tmp &= ~OP_MODE;
+	jz_sfc_writel(tmp, SFC_GLB);
+
+	if (!dir)
+		invalidate_dcache_range(start, start + length);
+
+	return ret;
+}
+
+static int sfc_dma_transfer(void *buf, unsigned int length, int dir)
+{
+	sfc_dma_start(buf, length);
+	return sfc_dma_wait(buf, length, dir);
+}
+#endif
+
 /*this code is same as the spl  in common/spl*/
 #if 0
 static void sfc_set_read_reg(unsigned int cmd, unsigned int addr,
@@ -548,6 +628,143 @@ void sfc_send_cmd(unsigned char *cmd,unsigned int len,unsigned int addr ,unsigne
 	}
 
 }
+/*
+ * Issue a command with a data phase and move the data.  Large cache line
+ * aligned buffers go through the SFC DMA, everything else through the FIFO.
+ */
+int sfc_xfer_data(unsigned char *cmd, unsigned int len, unsigned int addr,
+		unsigned addr_len, unsigned dummy_byte, void *buf, unsigned char dir)
+{
+#ifdef CONFIG_JZ_SFC_DMA
+	if (sfc_can_dma(buf, len)) {
+		struct jz_sfc sfc;
+
+		sfc.cmd = *cmd;
+		sfc.addr_len = addr_len;
+		sfc.addr = addr;
+		sfc.addr_plus = 0;
+		sfc.dummy_byte = dummy_byte;
+		sfc.daten = 1;
+		sfc.len = len;
+		sfc.sfc_mode = addr_len ? mode : 0;
+		sfc_set_transfer(&sfc, dir);
+		jz_sfc_writel(FLUSH, SFC_TRIG);
+
+		return sfc_dma_transfer(buf, len, dir);
+	}
+#endif
+	sfc_send_cmd(cmd, len, addr, addr_len, dummy_byte, 1, dir);
+	if (dir)
+		return sfc_write_data(buf, len);
+	return sfc_read_data(buf, len);
+}
+
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+/* runtime switch, "sfcnor wspeed" toggles it to compare the two paths */
+int sfc_auto_poll = 1;
+
+static void sfc_set_phase(struct jz_sfc *hw)
+{
+	int channel = hw->phase;
+	unsigned int tmp;
+
+	tmp = jz_sfc_readl(SFC_TRAN_CONF(channel));
+	tmp &= ~(TRAN_MODE_MSK | ADDR_WIDTH_MSK | POLLEN | CMDEN | FMAT |
+			DMYBITS_MSK | DATEEN | CMD_MSK);
+	tmp |= (hw->sfc_mode << TRAN_MODE_OFFSET) |
+		(hw->addr_len << ADDR_WIDTH_OFFSET) |
+		(hw->dummy_byte << DMYBITS_OFFSET) |
+		CMDEN | (hw->cmd << CMD_OFFSET);
+	if (hw->daten)
+		tmp |= DATEEN;
+	if (hw->pollen)
+		tmp |= POLLEN;
+	jz_sfc_writel(tmp, SFC_TRAN_CONF(channel));
+
+	sfc_dev_addr(channel, hw->addr);
+	sfc_dev_addr_plus(channel, hw->addr_plus);
+}
+
+static void sfc_set_phase_num(int num)
+{
+	unsigned int tmp;
+
+	tmp = jz_sfc_readl(SFC_GLB);
+	tmp &= ~PHASE_NUM_MSK;
+	tmp |= (num << PHASE_NUM_OFFSET);
+	jz_sfc_writel(tmp, SFC_GLB);
+}
+
+/*
+ * Chain WREN, @cmd (with the data in @buf, if any) and a status phase into
+ * one trigger.  The controller re-issues @poll_cmd by itself until the
+ * busy bit (bit 0 for both NOR RDSR and NAND GET_FEATURE 0xc0) clears and
+ * only then raises END.  Returns the final status byte or -1.
+ */
+int sfc_send_cmd_poll(unsigned char *cmd, unsigned int len, unsigned int addr,
+		unsigned addr_len, void *buf, unsigned char poll_cmd,
+		unsigned int poll_addr, unsigned poll_addr_len)
+{
+	struct jz_sfc sfc[3];
+	unsigned int tmp;
+	int i, ret = 0;
+
+	memset(sfc, 0, sizeof(sfc));
+	sfc[0].phase = 0;
+	sfc[0].cmd = CMD_WREN;
+
+	sfc[1].phase = 1;
+	sfc[1].cmd = *cmd;
+	sfc[1].addr = addr;
+	sfc[1].addr_len = addr_len;
+	sfc[1].daten = (buf != NULL);
+	sfc[1].sfc_mode = (buf && addr_len) ? mode : 0;
+
+	sfc[2].phase = 2;
+	sfc[2].cmd = poll_cmd;
+	sfc[2].addr = poll_addr;
+	sfc[2].addr_len = poll_addr_len;
+	sfc[2].pollen = 1;
+
+	for (i = 0; i < 3; i++)
+		sfc_set_phase(&sfc[i]);
+
+	/* one status byte, done when the busy bit reads 0 */
+	tmp = jz_sfc_readl(SFC_DEV_CONF);
+	tmp &= ~STA_TYPE_MSK;
+	jz_sfc_writel(tmp, SFC_DEV_CONF);
+	jz_sfc_writel(0, SFC_STA_EXP);
+	jz_sfc_writel(CMD_SR_WIP, SFC_DEV_STA_MSK);
+
+	sfc_transfer_direction(buf ? GLB_TRAN_DIR_WRITE : GLB_TRAN_DIR_READ);
+	sfc_set_length(buf ? len : 0);
+	sfc_set_phase_num(3);
+	jz_sfc_writel(FLUSH, SFC_TRIG);
+
+#ifdef CONFIG_JZ_SFC_DMA
+	if (buf && sfc_can_dma(buf, len)) {
+		ret = sfc_dma_transfer(buf, len, 1);
+	} else
+#endif
+	{
+		jz_sfc_writel(START, SFC_TRIG);
+		if (buf) {
+			ret = sfc_write_data(buf, len);
+		} else {
+			while (!(jz_sfc_readl(SFC_SR) & END))
+				sfc_busy_hook();
+			jz_sfc_writel(CLR_END, SFC_SCR);
+		}
+	}
+
+	sfc_set_phase_num(1);
+
+	if (ret < 0)
+		return ret;
+	return jz_sfc_readl(SFC_DEV_STA_RT) & 0xff;
+}
+#endif
+
 int sfc_nand_write_data(unsigned int *data,unsigned int length)
 {
 	return sfc_write_data(data,length);
@@ -592,7 +809,10 @@ int jz_sfc_read(struct spi_flash *flash, u32 offset, size_t len, void *data)
 {
 	unsigned char cmd[5];
 	unsigned long read_len;
-	unsigned int words_of_len = 0;
+#ifdef CONFIG_JZ_SFC_DMA
+	unsigned long dma_len;
+#endif
+	unsigned int dummy_byte = 0;
 	unsigned int i;
 
 	jz_sfc_set_address_mode(flash,1);
@@ -620,13 +840,21 @@ int jz_sfc_read(struct spi_flash *flash, u32 offset, size_t len, void *data)
 		 *
 		 * */
 
-	if(sfc_quad_mode == 1){
-		sfc_send_cmd(&cmd[0],read_len,offset,flash->addr_size,quad_mode->dummy_byte,1,0);
-	}else{
-		sfc_send_cmd(&cmd[0],read_len,offset,flash->addr_size,0,1,0);
+	if(sfc_quad_mode == 1)
+		dummy_byte = quad_mode->dummy_byte;
+
+#ifdef CONFIG_JZ_SFC_DMA
+	/* DMA the aligned bulk, the odd tail goes through the FIFO below */
+	dma_len = read_len & ~(ARCH_DMA_MINALIGN - 1);
+	if (dma_len && sfc_can_dma(data, dma_len)) {
+		sfc_xfer_data(&cmd[0],dma_len,offset,flash->addr_size,dummy_byte,data,0);
+		offset += dma_len;
+		read_len -= dma_len;
+		data += dma_len;
 	}
-	//	dump_sfc_reg();
-	sfc_read_data(data, len);
+	if (read_len)
+#endif
+	sfc_xfer_data(&cmd[0],read_len,offset,flash->addr_size,dummy_byte,data,0);
 
 	jz_sfc_set_address_mode(flash,0);
 
@@ -697,8 +925,6 @@ int jz_sfc_write(struct spi_flash *flash, u32 offset, size_t length, const void
 		 * dir
 		 *
 		 * */
-		sfc_send_cmd(&cmd[0],0,0,0,0,0,1);
-
 		if (!pagelen || pagelen > flash->page_size)
 			len = flash->page_size;
 		else
@@ -711,22 +937,28 @@ int jz_sfc_write(struct spi_flash *flash, u32 offset, size_t length, const void
 			cmd[i+2] = offset >> (flash->addr_size - i - 1) * 8;
 		}
 
-		sfc_send_cmd(&cmd[1], len,offset,flash->addr_size,0,1,1);
-
-	//	dump_sfc_reg();
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+		if (sfc_auto_poll) {
+			sfc_send_cmd_poll(&cmd[1],len,offset,flash->addr_size,send_buf,CMD_RDSR,0,0);
+		} else
+#endif
+		{
+			sfc_send_cmd(&cmd[0],0,0,0,0,0,1);
 
-		sfc_write_data(send_buf ,len);
+			sfc_xfer_data(&cmd[1], len,offset,flash->addr_size,0,send_buf,1);
 
-		retlen = len;
-
-		/*polling*/
-		sfc_send_cmd(&cmd[flash->addr_size + 2],1,0,0,0,1,0);
-		sfc_read_data(&tmp, 1);
-		while(tmp & CMD_SR_WIP) {
+			/*polling*/
 			sfc_send_cmd(&cmd[flash->addr_size + 2],1,0,0,0,1,0);
 			sfc_read_data(&tmp, 1);
+			while(tmp & CMD_SR_WIP) {
+				sfc_busy_hook();
+				sfc_send_cmd(&cmd[flash->addr_size + 2],1,0,0,0,1,0);
+				sfc_read_data(&tmp, 1);
+			}
 		}
 
+		retlen = len;
+
 		if (!retlen) {
 			printf("spi nor write failed\n");
 			return -1;
@@ -847,15 +1079,23 @@ int jz_sfc_erase(struct spi_flash *flash, u32 offset, size_t len)
 		 * dir
 		 *
 		 * */
-		sfc_send_cmd(&cmd[0],0,0,0,0,0,1);
+#ifdef CONFIG_JZ_SFC_AUTO_POLL
+		if (sfc_auto_poll) {
+			sfc_send_cmd_poll(&cmd[1],0,offset,flash->addr_size,NULL,CMD_RDSR,0,0);
+		} else
+#endif
+		{
+			sfc_send_cmd(&cmd[0],0,0,0,0,0,1);
 
-		sfc_send_cmd(&cmd[1],0,offset,flash->addr_size,0,0,1);
+			sfc_send_cmd(&cmd[1],0,offset,flash->addr_size,0,0,1);
 
-		sfc_send_cmd(&cmd[flash->addr_size + 2], 1,0,0,0,1,0);
-		sfc_read_data(&buf, 1);
-		while(buf & CMD_SR_WIP) {
 			sfc_send_cmd(&cmd[flash->addr_size + 2], 1,0,0,0,1,0);
 			sfc_read_data(&buf, 1);
+			while(buf & CMD_SR_WIP) {
+				sfc_busy_hook();
+				sfc_send_cmd(&cmd[flash->addr_size + 2], 1,0,0,0,1,0);
+				sfc_read_data(&buf, 1);
+			}
 		}
 
 		offset += erase_size;
@@ -1204,6 +1444,190 @@ int sfc_nor_read(unsigned int src_addr, unsigned int count,unsigned int dst_addr
 	return 0;
 }
 
+/* chip geometry for the users that do not go through spi_flash */
+int sfc_nor_get_info(unsigned int *size, unsigned int *sector_size)
+{
+	if(sfc_is_init == 0 && sfc_init() < 0)
+		return -1;
+
+	*size = gparams.size;
+	*sector_size = gparams.sector_size;
+	return 0;
+}
+
+#ifdef CONFIG_SFC_NOR_SHADOW
+/*
+ * The SFC has no memory mapped read mode, so the "mapping" is a DRAM shadow
+ * of the first CONFIG_SFC_NOR_SHADOW_SIZE bytes of the flash, 1:1 from the
+ * top of DRAM board_init_f() reserved for it.  sfc_nor_map() reads the chunks of a range
+ * that are not there yet, one DMA per run of missing chunks, and hands out
+ * a pointer into the shadow.  Writes and erases drop what they touch.
+ */
+#ifndef CONFIG_SFC_NOR_SHADOW_CHUNK
+#define CONFIG_SFC_NOR_SHADOW_CHUNK	(64 << 10)
+#endif
+
+#define SFC_NOR_SHADOW_CHUNKS \
+	(CONFIG_SFC_NOR_SHADOW_SIZE / CONFIG_SFC_NOR_SHADOW_CHUNK)
+
+static u32 sfc_nor_shadow_valid[(SFC_NOR_SHADOW_CHUNKS + 31) / 32];
+
+static int sfc_nor_shadow_has(unsigned int chunk)
+{
+	return sfc_nor_shadow_valid[chunk / 32] & (1 << (chunk % 32));
+}
+
+static void sfc_nor_shadow_mark(unsigned int first, unsigned int last,
+				int valid)
+{
+	for (; first <= last; first++) {
+		if (valid)
+			sfc_nor_shadow_valid[first / 32] |= 1 << (first % 32);
+		else
+			sfc_nor_shadow_valid[first / 32] &= ~(1 << (first % 32));
+	}
+}
+
+int sfc_nor_in_shadow(const void *buf)
+{
+	return (ulong)buf >= gd->arch.sfc_nor_shadow &&
+	       (ulong)buf < gd->arch.sfc_nor_shadow + CONFIG_SFC_NOR_SHADOW_SIZE;
+}
+
+void *sfc_nor_map(unsigned int offset, unsigned int len)
+{
+	u8 *shadow = (u8 *)gd->arch.sfc_nor_shadow;
+	unsigned int chunk = CONFIG_SFC_NOR_SHADOW_CHUNK;
+	unsigned int first, last, run;
+
+	if (sfc_is_init == 0 && sfc_init() < 0)
+		return NULL;
+	if (!len || offset + len < offset ||
+	    offset + len > CONFIG_SFC_NOR_SHADOW_SIZE ||
+	    offset + len > gparams.size)
+		return NULL;
+
+	first = offset / chunk;
+	last = (offset + len - 1) / chunk;
+	while (first <= last) {
+		if (sfc_nor_shadow_has(first)) {
+			first++;
+			continue;
+		}
+		for (run = first; run < last && !sfc_nor_shadow_has(run + 1);
+		     run++)
+			;
+		if (sfc_nor_read(first * chunk, (run - first + 1) * chunk,
+				 (unsigned int)(shadow + first * chunk)))
+			return NULL;
+		sfc_nor_shadow_mark(first, run, 1);
+		first = run + 1;
+	}
+
+	return shadow + offset;
+}
+
+/* erases round out to sectors, drop the whole sectors */
+void sfc_nor_unmap(unsigned int offset, unsigned int len)
+{
+	unsigned int chunk = CONFIG_SFC_NOR_SHADOW_CHUNK;
+	unsigned int sector = gparams.sector_size ? gparams.sector_size : chunk;
+	unsigned int end;
+
+	if (!len || offset >= CONFIG_SFC_NOR_SHADOW_SIZE)
+		return;
+
+	end = ALIGN(offset + len, sector);
+	offset &= ~(sector - 1);
+	if (end > CONFIG_SFC_NOR_SHADOW_SIZE || end < offset)
+		end = CONFIG_SFC_NOR_SHADOW_SIZE;
+	sfc_nor_shadow_mark(offset / chunk, (end - 1) / chunk, 0);
+}
+#else
+static inline void sfc_nor_unmap(unsigned int offset, unsigned int len) {}
+#endif
+
+#ifdef CONFIG_JZ_SFC_DMA
+/* the one read sfc_nor_read_start() left running */
+static struct {
+	struct spi_flash flash;
+	void *buf;
+	unsigned int len;
+	int busy;
+} sfc_async;
+
+/*
+ * Start a DMA read of @count bytes at @src_addr and return at once, the CPU
+ * may do other work until sfc_nor_read_wait().  @buf must satisfy
+ * sfc_can_dma(), no other SFC access is allowed in between.
+ */
+int sfc_nor_read_start(unsigned int src_addr, unsigned int count, void *buf)
+{
+	struct spi_flash *flash = &sfc_async.flash;
+	struct jz_sfc sfc;
+	unsigned int dummy_byte = 0;
+
+	if (sfc_async.busy || !sfc_can_dma(buf, count))
+		return -1;
+
+#ifdef CONFIG_SPI_QUAD
+	sfc_quad_mode = 1;
+#endif
+	if (sfc_is_init == 0 && sfc_init() < 0)
+		return -1;
+
+	flash->page_size = gparams.page_size;
+	flash->sector_size = gparams.sector_size;
+	flash->size = gparams.size;
+	flash->addr_size = gparams.addr_size;
+
+	if (sfc_quad_mode == 1 && quad_mode_is_set == 0)
+		sfc_set_quad_mode();
+
+	jz_sfc_writel(1 << 2, SFC_TRIG);
+	jz_sfc_set_address_mode(flash, 1);
+
+	if (sfc_quad_mode == 1) {
+		sfc.cmd = quad_mode->cmd_read;
+		mode = quad_mode->sfc_mode;
+		dummy_byte = quad_mode->dummy_byte;
+	} else {
+		sfc.cmd = CMD_READ;
+		mode = TRAN_SPI_STANDARD;
+	}
+	sfc.addr_len = flash->addr_size;
+	sfc.addr = src_addr;
+	sfc.addr_plus = 0;
+	sfc.dummy_byte = dummy_byte;
+	sfc.daten = 1;
+	sfc.len = count;
+	sfc.sfc_mode = mode;
+	sfc_set_transfer(&sfc, 0);
+	jz_sfc_writel(FLUSH, SFC_TRIG);
+
+	sfc_async.buf = buf;
+	sfc_async.len = count;
+	sfc_async.busy = 1;
+	sfc_dma_start(buf, count);
+
+	return 0;
+}
+
+int sfc_nor_read_wait(void)
+{
+	int ret;
+
+	if (!sfc_async.busy)
+		return 0;
+
+	ret = sfc_dma_wait(sfc_async.buf, sfc_async.len, 0);
+	jz_sfc_set_address_mode(&sfc_async.flash, 0);
+	sfc_async.busy = 0;
+
+	return ret;
+}
+#endif
+
 int sfc_nor_write(unsigned int src_addr, unsigned int count,unsigned int dst_addr,unsigned int erase_en)
 {
 
@@ -1256,6 +1680,7 @@ int sfc_nor_write(unsigned int src_addr, unsigned int count,unsigned int dst_add
 #endif
 
 	jz_sfc_writel(1 << 2,SFC_TRIG);
+	sfc_nor_unmap(src_addr, count);
 
 	if(erase_en == 1){
 		jz_sfc_erase(&flash,src_addr,count);
@@ -1322,6 +1747,7 @@ int sfc_nor_erase(unsigned int src_addr, unsigned int count)
 	}
 
 	jz_sfc_writel(1 << 2,SFC_TRIG);
+	sfc_nor_unmap(src_addr, count);
 	ret = jz_sfc_erase(&flash,src_addr,count);
 	if (ret) {
 		printf("sfc erase error\n");
@@ -43,7 +43,10 @@
 #define RET_LENGTH	64
 
 #define CMD_COUNT	22
-#define MMC_BYTE_PER_BLOCK 512
+/* download piece of "oem stream", two are in use */
+#define STREAM_CHUNK	(512 * 1024)
+/* what a buffered download may take out of the heap */
+#define MAX_DOWNLOAD	(CONFIG_SYS_MALLOC_LEN / 2)
 #ifndef PARTITION_NUM
 #define PARTITION_NUM 16
 #endif
@@ -74,6 +77,14 @@ struct fastboot_dev {
 	int			locked;
 	int			leave;
 	int			cmd_count;
+
+	struct fb_flash		flash;
+	struct partition_info	*stream_part;	/* set by "oem stream" */
+	struct partition_info	*streamed;	/* the last download went there */
+	int			stream_err;
+	char			*stream_buf[2];
+	int			stream_cur;
+	u32			stream_recv;
 };
 
 
@@ -600,6 +611,13 @@ static void explain_cmd_getvar_all(struct fastboot_dev *fastboot)
 
 static int handle_cmd_getvar(struct fastboot_dev *fastboot)
 {
+	if (strstr(fastboot->cmd_req->buf, "max-download-size")) {
+		/* a streamed download never sits in RAM as a whole */
+		sprintf(fastboot->ret_buf, "OKAY0x%08lx", fastboot->stream_part ?
+			fastboot->stream_part->size : (ulong)MAX_DOWNLOAD);
+		return 0;
+	}
+
 	if (strstr(fastboot->cmd_req->buf, "version-bootloader")) {
 		strcpy(fastboot->ret_buf, "OKAY");
 		strcat(fastboot->ret_buf, CONFIG_FASTBOOT_BOOTLOADER_VER);
@@ -776,6 +794,117 @@ static void flash_download_data(struct fastboot_dev *fastboot)
 	fastboot->data_buf = NULL;
 }
 
+static void stream_data_over(struct fastboot_dev *fastboot)
+{
+	if (fastboot->data_req)
+		usb_ep_free_request(fastboot_common->bulk_out, fastboot->data_req);
+	fastboot->data_req = NULL;
+	free(fastboot->stream_buf[0]);
+	free(fastboot->stream_buf[1]);
+	fastboot->stream_buf[0] = fastboot->stream_buf[1] = NULL;
+
+	fastboot->stream_err = fb_flash_close(&fastboot->flash);
+	fastboot->streamed = fastboot->stream_part;
+	strcpy(fastboot->ret_buf, fastboot->stream_err ? "FAILED" : "OKAY");
+	return_buf(fastboot, return_complete);
+}
+
+/*
+ * Queue the next piece into the other buffer before this one is written,
+ * the host goes on sending while the flash is busy as far as the UDC can
+ * take it. Errors drop the rest of the data but the download completes.
+ */
+static void stream_data_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct fastboot_dev *fastboot = req->context;
+	void *done = req->buf;
+	unsigned int actual = req->actual;
+
+	if (req->status) {
+		printf("%s: transfer error %d\n", __func__, req->status);
+		fastboot->flash.err = -EIO;
+		fastboot->stream_recv = fastboot->data_length;
+	} else {
+		fastboot->stream_recv += actual;
+	}
+
+	if (fastboot->stream_recv < fastboot->data_length) {
+		fastboot->stream_cur ^= 1;
+		req->buf = fastboot->stream_buf[fastboot->stream_cur];
+		req->length = min_t(u32, STREAM_CHUNK,
+				fastboot->data_length - fastboot->stream_recv);
+		req->status = 0;
+		usb_ep_queue(fastboot_common->bulk_out, req, 0);
+	}
+
+	fb_flash_write(&fastboot->flash, done, actual);
+
+	if (fastboot->stream_recv >= fastboot->data_length)
+		stream_data_over(fastboot);
+}
+
+static void stream_download_complete(struct usb_ep *ep,
+		struct usb_request *req)
+{
+	struct fastboot_dev *fastboot = req->context;
+
+	fastboot->cmd_req = NULL;
+	fastboot->data_req = usb_ep_alloc_request(fastboot_common->bulk_out, 0);
+	if (!fastboot->data_req) {
+		printf("%s: Error, usb alloc request\n", __func__);
+		/* nothing was written, drop the buffers and answer FAILED */
+		fastboot->flash.err = -ENOMEM;
+		stream_data_over(fastboot);
+		return;
+	}
+
+	fastboot->stream_cur = 0;
+	fastboot->stream_recv = 0;
+	if (!fastboot->data_length) {
+		stream_data_over(fastboot);
+		return;
+	}
+
+	printf("streaming 0x%x bytes to %s\n", fastboot->data_length,
+	       fastboot->stream_part->pname);
+	fastboot->data_req->buf = fastboot->stream_buf[0];
+	fastboot->data_req->length = min_t(u32, STREAM_CHUNK,
+					   fastboot->data_length);
+	fastboot->data_req->complete = stream_data_complete;
+	fastboot->data_req->status = 0;
+	fastboot->data_req->actual = 0;
+	fastboot->data_req->context = fastboot;
+	usb_ep_queue(fastboot_common->bulk_out, fastboot->data_req, 0);
+}
+
+/* "oem stream" is set: write the data as it comes instead of keeping it */
+static int handle_stream_download(struct fastboot_dev *fastboot)
+{
+	int i;
+
+	if (fastboot->data_buf) {
+		free(fastboot->data_buf);
+		fastboot->data_buf = NULL;
+	}
+	fastboot->streamed = NULL;
+
+	for (i = 0; i < 2; i++) {
+		fastboot->stream_buf[i] = memalign(CONFIG_SYS_CACHELINE_SIZE,
+						   STREAM_CHUNK);
+		if (!fastboot->stream_buf[i]) {
+			printf("%s: malloc for stream buffer failed\n",
+			       __func__);
+			free(fastboot->stream_buf[0]);
+			fastboot->stream_buf[0] = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	/* an open error is kept in the writer, the data is still taken */
+	fb_flash_open(&fastboot->flash, fastboot->stream_part);
+	return 0;
+}
+
 static int explain_cmd_download(struct fastboot_dev *fastboot)
 {
 	char	buf_length[9];
@@ -792,13 +921,18 @@ static int explain_cmd_download(struct fastboot_dev *fastboot)
 
 	fastboot->data_length = (u32)simple_strtol(buf_length, NULL, 16);
 
-	ret = handle_cmd_download(fastboot);
+	if (fastboot->stream_part)
+		ret = handle_stream_download(fastboot);
+	else
+		ret = handle_cmd_download(fastboot);
 	if (ret != 0) {
 		printf("%s: Error in the handle download cmd:%d\n", __func__, ret);
 		return ret;
 	}
 
-	ret = fastboot_cmd_return(fastboot, handle_download_complete, status, actual);
+	ret = fastboot_cmd_return(fastboot, fastboot->stream_part ?
+				  stream_download_complete :
+				  handle_download_complete, status, actual);
 	if (ret != 0) {
 		printf("%s: Error in the fastboot_cmd_return,%d\n",__func__, ret);
 		return ret;
@@ -806,17 +940,7 @@ static int explain_cmd_download(struct fastboot_dev *fastboot)
 	return 0;
 }
 
-static int mmc_flash(u32 blk,u32 cnt,struct fastboot_dev *fastboot)
-{
-	char command[128];
-	memset(command , 0, 128);
-	void *addr = (void *)fastboot->data_buf;
-	sprintf(command,"mmc write %p %x %x",addr,blk,cnt);
-	run_command(command,"0");
-	printf("mmc flash OK!\n");
-	return 0;
-}
-
+#if defined(CONFIG_JZ_NAND_MGR) && !defined(CONFIG_SPL_MMC_SUPPORT)
 int nand_flash(unsigned char *pt_name,struct fastboot_dev *fastboot)
 {
 	int curr_device = 0;
@@ -831,59 +955,51 @@ int nand_flash(unsigned char *pt_name,struct fastboot_dev *fastboot)
 
 	return 0;
 }
+#endif
 
-int spi_flash(u32 offset, struct fastboot_dev *fastboot)
+static struct partition_info *fastboot_find_part(const char *name)
 {
-	u32 length = fastboot->data_length;
-	void *databuf = (void *)fastboot->data_buf;
+	int i, len;
 
-	char command[128];
-	memset(command,0,128);
-	/* sfcnor write  [src:nor flash addr] [bytes:0x..] [dst:der address] [force erase:1, nor erase:0] */
-	sprintf(command,"sfcnor write 0x%x 0x%x 0x%x 1",offset,length,databuf);
-	printf("command:%s\n",command);
-	run_command(command,"0");
+	for (i = 0; i < PARTITION_NUM; i++) {
+		len = strlen(partition_info[i].pname);
+		if (len > 2 && !strncmp(partition_info[i].pname + 2, name, len - 2))
+			return &partition_info[i];
+	}
 
-	return 0;
+	printf("There is not a partition named : %s\n", name);
+	return NULL;
 }
 
 static int handle_cmd_flash(struct fastboot_dev *fastboot)
 {
-	int i;
-	printf("please add the flash cmd explain roution\n");
-	u32 blk,cnt,offset;
-	unsigned char *pname;
-	memset(pname, 0 , 128);
-	for(i = 0; i < PARTITION_NUM ; i ++){
-		if(!strncmp(partition_info[i].pname + 2 , boot_buf + 6,(strlen(partition_info[i].pname)-2))){
-			strcpy(pname,partition_info[i].pname);
-			offset = partition_info[i].offset;
-			blk = partition_info[i].offset / MMC_BYTE_PER_BLOCK;
-			cnt = (fastboot->data_length + MMC_BYTE_PER_BLOCK - 1) / MMC_BYTE_PER_BLOCK;
-			goto do_flash;
-			break;
+	struct partition_info *part = fastboot_find_part(boot_buf + 6);
+	struct partition_info *streamed = fastboot->streamed;
+
+	if (!part)
+		return -1;
+
+	/* written while it was downloaded, just report how that went */
+	if (streamed) {
+		fastboot->streamed = NULL;
+		if (streamed != part) {
+			printf("the data was streamed to %s\n", streamed->pname);
+			return -1;
 		}
+		return fastboot->stream_err ? -1 : 0;
 	}
-	if(i == PARTITION_NUM){
-		printf("There is not a partition named : %s\n",boot_buf + 6);
+
+	if (!fastboot->data_buf)
 		return -1;
-	}
 
-do_flash:
-#ifdef CONFIG_SPL_MMC_SUPPORT
-	if(!mmc_flash(blk,cnt,fastboot))
-		return 0;
+#if defined(CONFIG_JZ_NAND_MGR) && !defined(CONFIG_SPL_MMC_SUPPORT)
+	return nand_flash((unsigned char *)part->pname, fastboot);
 #else
-#ifdef CONFIG_JZ_NAND_MGR
-	if(!nand_flash(pname,fastboot))
-		return 0;
-#endif
-#ifdef CONFIG_JZ_SFC
-	if(!spi_flash(offset,fastboot))
-		return 0;
+	fb_flash_open(&fastboot->flash, part);
+	fb_flash_write(&fastboot->flash, fastboot->data_buf,
+		       fastboot->data_length);
+	return fb_flash_close(&fastboot->flash) ? -1 : 0;
 #endif
-#endif
-	return -1;
 }
 
 static void explain_cmd_flash(struct fastboot_dev *fastboot)
@@ -896,19 +1012,7 @@ static void explain_cmd_flash(struct fastboot_dev *fastboot)
 	return_buf(fastboot, return_complete);
 }
 
-static int fastboot_mmc_erase(u32 blk,u32 blk_cnt,struct fastboot_dev *fastboot)
-{
-	int curr_device = 0;
-
-	char commond[128] ;
-	memset(commond,0,128);
-	sprintf(commond,"mmc erase %x %x",blk,blk_cnt);
-	run_command(commond,"0");
-
-	printf("mmc erase ok\n");
-	return 0;
-}
-
+#if defined(CONFIG_JZ_NAND_MGR) && !defined(CONFIG_SPL_MMC_SUPPORT)
 static int fastboot_nand_erase(unsigned char *pname,struct fastboot_dev *fastboot)
 {
 	char command[128];
@@ -916,57 +1020,22 @@ static int fastboot_nand_erase(unsigned char *pname,struct fastboot_dev *fastboo
 	sprintf(command,"nand_zm erase %s",pname);
 	printf("command:%s\n",command);
 	run_command(command,"0");
+	return 0;
 }
-
-static int fastboot_spi_erase(u32 offset, u32 size, struct fastboot_dev *fastboot)
-{
-	char command[128];
-	memset(command,0,128);
-	/* sfcnor erase  [src:nor flash addr] [bytes:0x..] */
-	sprintf(command,"sfcnor erase 0x%x 0x%x",offset,size);
-	printf("command:%s\n",command);
-	run_command(command,"0");
-}
+#endif
 
 static int handle_cmd_erase(struct fastboot_dev *fastboot)
 {
-	printf("please add the erase cmd explain roution\n");
-	u32 blk,cnt,offset,size;
-	int i;
-	unsigned char *pname;
-	memset(pname, 0 , 128);
-	for(i = 0; i < PARTITION_NUM ; i ++){
-		if(!strncmp(partition_info[i].pname + 2 , boot_buf + 6,(strlen(partition_info[i].pname)-2))){
-			strcpy(pname,partition_info[i].pname);
-			offset = partition_info[i].offset;
-			size = partition_info[i].size;
-			blk = partition_info[i].offset / MMC_BYTE_PER_BLOCK;
-			cnt = (partition_info[i].size + MMC_BYTE_PER_BLOCK - 1) / MMC_BYTE_PER_BLOCK;
-			goto do_erase;
-			break;
-		}
-	}
-	if(i == PARTITION_NUM){
-		printf("There is not a partition named : %s\n",boot_buf + 6);
+	struct partition_info *part = fastboot_find_part(boot_buf + 6);
+
+	if (!part)
 		return -1;
-	}
 
-do_erase:
-#ifdef CONFIG_SPL_MMC_SUPPORT
-	if(!fastboot_mmc_erase(blk , cnt ,fastboot))
-		return 0;
+#if defined(CONFIG_JZ_NAND_MGR) && !defined(CONFIG_SPL_MMC_SUPPORT)
+	return fastboot_nand_erase((unsigned char *)part->pname, fastboot);
 #else
-#ifdef CONFIG_JZ_NAND_MGR
-	if(!fastboot_nand_erase(pname,fastboot))
-		return 0;
-#endif
-#ifdef CONFIG_JZ_SFC
-	if(!fastboot_spi_erase(offset,size,fastboot))
-		return 0;
+	return fb_flash_erase(part) ? -1 : 0;
 #endif
-#endif
-
-	return -1;
 }
 
 static void explain_cmd_erase(struct fastboot_dev *fastboot)
@@ -1074,8 +1143,27 @@ static void explain_cmd_boot(struct fastboot_dev *fastboot)
 	return_buf(fastboot, return_complete);
 }
 
+/*
+ * "oem stream <partition>": the following downloads are written to the
+ * partition while they come in, the flash command after each only reports
+ * the result. "oem stream" alone goes back to buffered downloads.
+ */
 static int handle_cmd_oem(struct fastboot_dev *fastboot)
 {
+	char *arg = fastboot->cmd_req->buf + 4;
+
+	if (!strncmp(arg, "stream", 6)) {
+		arg += 6;
+		while (*arg == ' ')
+			arg++;
+		if (!*arg) {
+			fastboot->stream_part = NULL;
+			return 0;
+		}
+		fastboot->stream_part = fastboot_find_part(arg);
+		return fastboot->stream_part ? 0 : -1;
+	}
+
 	printf("please add the oem cmd explain roution\n");
 	return -1;
 }
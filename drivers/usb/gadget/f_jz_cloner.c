@@ -233,11 +233,24 @@ int cloner_init(struct cloner *cloner)
 	return 0;
 }
 
+/*
+ * Grow the transfer buffer, the old contents are not kept, every caller
+ * fills it anew.  Returns NULL and leaves the old buffer in place if there
+ * is no memory for the new one.
+ */
 void *realloc_buf(struct cloner *cloner, size_t realloc_size)
 {
+	void *buf;
+
 	if (unlikely(cloner->buf_size < realloc_size)) {
+		buf = memalign(CONFIG_SYS_CACHELINE_SIZE, realloc_size);
+		if (!buf) {
+			printf("no memory for a 0x%x byte transfer\n", realloc_size);
+			return NULL;
+		}
+		free(cloner->buf);
+		cloner->buf = buf;
 		cloner->buf_size = realloc_size;
-		cloner->buf = realloc(cloner->buf,cloner->buf_size);
 		cloner->write_req->buf = cloner->read_req->buf = cloner->buf;
 	}
 	return cloner->buf;
@@ -252,7 +265,10 @@ void handle_read(struct cloner *cloner)
 	case OPS(MMC,0):
 	case OPS(MMC,1):
 	case OPS(MMC,2):
-		realloc_buf(cloner, ((cloner->cmd->read.length + 0x200) & (~(0x200 - 1))));
+		if (!realloc_buf(cloner, ((cloner->cmd->read.length + 0x200) & (~(0x200 - 1))))) {
+			cloner->ack = -ENOMEM;
+			return;
+		}
 		ret = mmc_read_x((cloner->cmd->read.ops & 0xffff),
 				cloner->read_req->buf,
 				cloner->cmd->read.partation + cloner->cmd->read.offset,
@@ -310,101 +326,274 @@ int handle_check(struct cloner *cloner)
 #undef OPS
 }
 
-void handle_write(struct usb_ep *ep,struct usb_request *req)
+/*
+ * Program the chunk described by cloner->cmd from cloner->write_req->buf,
+ * returns the ack for it.
+ */
+static int cloner_program(struct cloner *cloner)
 {
-	struct cloner *cloner = req->context;
-
-	if(req->status == -ECONNRESET) {
-		cloner->ack = -ECONNRESET;
-		return;
-	}
-
-	if (req->actual != req->length) {
-		printf("write transfer length is err,actual=%08x,length=%08x\n",req->actual,req->length);
-		cloner->ack = -EIO;
-		return;
-	}
-
-	if(cloner->cmd_type == VR_UPDATE_CFG) {
-		cloner->ack = 0;
-		return;
-	}
-
-	if (cloner->args->transfer_data_chk) {
-		uint32_t tmp_crc = local_crc32(0xffffffff,req->buf,req->actual);
-		if (cloner->cmd->write.crc != tmp_crc) {
-			printf("crc is errr! src crc=%08x crc=%08x\n",cloner->cmd->write.crc,tmp_crc);
-			cloner->ack = -EINVAL;
-			return;
-		}
-	}
+	int ack;
 #define OPS(x,y) ((x<<16)|(y&0xffff))
 	switch(cloner->cmd->write.ops) {
 		case OPS(I2C,RAW):
-			cloner->ack = i2c_program(cloner);
+			ack = i2c_program(cloner);
 			break;
 #ifdef CONFIG_JZ_NAND_MGR
 		case OPS(NAND,IMAGE):
-			cloner->ack = nand_program(cloner);
+			ack = nand_program(cloner);
 			break;
 #endif
 #ifdef CONFIG_MTD_NAND_JZ
 		case OPS(NAND, MTD_RAW):
-			cloner->ack = nand_mtd_raw_program(cloner);
+			ack = nand_mtd_raw_program(cloner);
 			break;
 		case OPS(NAND, MTD_UBI):
-			cloner->ack = nand_mtd_ubi_program(cloner);
+			ack = nand_mtd_ubi_program(cloner);
 			break;
 #endif
 #ifdef CONFIG_JZ_MMC
 		case OPS(MMC,0):
 		case OPS(MMC,1):
 		case OPS(MMC,2):
-			cloner->ack = mmc_program(cloner,cloner->cmd->write.ops & 0xffff);
+			ack = mmc_program(cloner,cloner->cmd->write.ops & 0xffff);
 			break;
 #endif
 #ifdef CONFIG_CMD_EFUSE
 		case OPS(EFUSE,RAW):
-			cloner->ack = efuse_program(cloner);
+			ack = efuse_program(cloner);
 			break;
 #endif
 		case OPS(SPI_NOR,RAW):
-			cloner->ack = spi_program(cloner);
+			ack = spi_program(cloner);
 			break;
 #ifdef CONFIG_MTD_SPINAND
 		case OPS(SPI_NAND,RAW):
-			cloner->ack = spinand_program(cloner);
+			ack = spinand_program(cloner);
 			break;
 #endif
 #ifdef CONFIG_JZ_SFC
 		case OPS(SFC_NOR,RAW):
-			cloner->ack = sfc_program(cloner);
+			ack = sfc_program(cloner);
 			break;
 #endif
 #ifdef CONFIG_MTD_SFCNAND
 		case OPS(SFC_NAND,RAW):
-			cloner->ack = spinand_program(cloner);
+			ack = spinand_program(cloner);
 			break;
 #endif
 		case OPS(MEMORY,RAW):
-			cloner->ack = 0;
+			ack = 0;
 			break;
 		case OPS(REGISTER,RAW):
 			{
 				volatile unsigned int *tmp = (void *)cloner->cmd->write.partation;
 				if((unsigned)tmp > 0xb0000000 && (unsigned)tmp < 0xb8000000) {
 					*tmp = *((int*)cloner->write_req->buf);
-					cloner->ack = 0;
+					ack = 0;
 				} else {
 					printf("OPS(REGISTER,RAW): not supported address.");
-					cloner->ack = -ENODEV;
+					ack = -ENODEV;
 				}
 			}
 			break;
 		default:
-			cloner->ack = clmg_write(cloner);
+			ack = clmg_write(cloner);
 	}
 #undef OPS
+	return ack;
+}
+
+#ifdef CONFIG_CLONER_PIPELINE
+/* how long a received chunk waits for the next VR_WRITE before it is written */
+#define CLONER_PIPE_IDLE_MS	20
+
+static struct cloner *pipe_cloner;
+
+/*
+ * Only media whose driver calls sfc_busy_hook() while the flash is busy go
+ * through the ring, anything else would just be programmed later, not in
+ * parallel.
+ */
+static int cloner_can_defer(uint32_t ops)
+{
+	switch (MOUDLE_TYPE(ops)) {
+#ifdef CONFIG_JZ_SFC
+	case SFC_NOR:
+#endif
+#ifdef CONFIG_MTD_SFCNAND
+	case SFC_NAND:
+#endif
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* run cloner_program() on the arguments and buffer of @slot */
+static int cloner_program_slot(struct cloner *cloner, struct cloner_slot *slot)
+{
+	union cmd *cmd = cloner->cmd;
+	struct usb_request *req = cloner->write_req;
+	int ack;
+
+	cloner->cmd = &slot->cmd;
+	cloner->write_req = slot->req;
+	cloner->programming = 1;
+	ack = cloner_program(cloner);
+	cloner->programming = 0;
+	cloner->cmd = cmd;
+	cloner->write_req = req;
+
+	return ack;
+}
+
+/* program the oldest received slot, returns 0 if there was none */
+static int cloner_pipe_step(struct cloner *cloner)
+{
+	struct cloner_slot *slot = &cloner->slot[cloner->slot_tail];
+	int ret;
+
+	if (!slot->pending)
+		return 0;
+
+	ret = cloner_program_slot(cloner, slot);
+	if (ret && !cloner->pipe_err) {
+		printf("deferred program of offset 0x%x failed %d\n",
+				slot->cmd.write.offset, ret);
+		cloner->pipe_err = ret;
+	}
+
+	slot->pending = 0;
+	cloner->slot_tail = (cloner->slot_tail + 1) % CONFIG_CLONER_RING_NUM;
+	return 1;
+}
+
+static void cloner_pipe_flush(struct cloner *cloner)
+{
+	while (cloner_pipe_step(cloner))
+		;
+}
+
+/*
+ * From the poll loop: the oldest chunk goes to the flash once the host has
+ * started the next one, so that one is received while this is programmed.
+ * The last chunk of a transfer goes after a short quiet time.
+ */
+void usb_gadget_idle(void)
+{
+	struct cloner *cloner = pipe_cloner;
+	struct cloner_slot *slot;
+
+	if (!cloner || cloner->programming)
+		return;
+
+	slot = &cloner->slot[cloner->slot_tail];
+	if (!slot->pending)
+		return;
+	if (cloner->slot[cloner->slot_head].queued ||
+	    get_timer(slot->stamp) >= CLONER_PIPE_IDLE_MS)
+		cloner_pipe_step(cloner);
+}
+
+/* the flash is busy with a slot, keep the next one coming in */
+void sfc_busy_hook(void)
+{
+	if (pipe_cloner && pipe_cloner->programming)
+		usb_gadget_poll_out();
+}
+
+/*
+ * Queue the OUT transfer of the next chunk into the head slot.  Fails if
+ * the slot has no request or buffer, the caller then takes the chunk the
+ * unpipelined way.
+ */
+static int cloner_queue_slot(struct cloner *cloner, union cmd *cmd)
+{
+	struct cloner_slot *slot = &cloner->slot[cloner->slot_head];
+	void *buf;
+
+	if (!slot->req)
+		return -ENOMEM;
+
+	/* ring full, the oldest chunk has to be written out first */
+	if (slot->pending)
+		cloner_pipe_step(cloner);
+
+	if (slot->buf_size < cmd->write.length) {
+		buf = memalign(CONFIG_SYS_CACHELINE_SIZE, cmd->write.length);
+		if (!buf)
+			return -ENOMEM;
+		free(slot->buf);
+		slot->buf = buf;
+		slot->buf_size = cmd->write.length;
+		slot->req->buf = slot->buf;
+	}
+	memcpy(&slot->cmd, cmd, sizeof(union cmd));
+	slot->req->length = cmd->write.length;
+	slot->queued = 1;
+	usb_ep_queue(cloner->ep_out, slot->req, 0);
+	return 0;
+}
+#endif
+
+void handle_write(struct usb_ep *ep,struct usb_request *req)
+{
+	struct cloner *cloner = req->context;
+#ifdef CONFIG_CLONER_PIPELINE
+	struct cloner_slot *slot = NULL;
+	int i;
+
+	for (i = 0; i < CONFIG_CLONER_RING_NUM; i++)
+		if (cloner->slot[i].req == req)
+			slot = &cloner->slot[i];
+	if (slot)
+		slot->queued = 0;
+#endif
+
+	if(req->status == -ECONNRESET) {
+		cloner->ack = -ECONNRESET;
+		return;
+	}
+
+	if (req->actual != req->length) {
+		printf("write transfer length is err,actual=%08x,length=%08x\n",req->actual,req->length);
+		cloner->ack = -EIO;
+		return;
+	}
+
+	if(cloner->cmd_type == VR_UPDATE_CFG) {
+		cloner->ack = 0;
+		return;
+	}
+
+	if (cloner->args->transfer_data_chk) {
+		union cmd *cmd = cloner->cmd;
+		uint32_t tmp_crc;
+#ifdef CONFIG_CLONER_PIPELINE
+		/* ep0 may already carry the next VR_WRITE */
+		if (slot)
+			cmd = &slot->cmd;
+#endif
+		tmp_crc = local_crc32(0xffffffff,req->buf,req->actual);
+		if (cmd->write.crc != tmp_crc) {
+			printf("crc is errr! src crc=%08x crc=%08x\n",cmd->write.crc,tmp_crc);
+			cloner->ack = -EINVAL;
+			return;
+		}
+	}
+
+#ifdef CONFIG_CLONER_PIPELINE
+	/* slots only carry media that can be deferred, see handle_cmd() */
+	if (slot) {
+		slot->pending = 1;
+		slot->stamp = get_timer(0);
+		cloner->slot_head = (cloner->slot_head + 1) % CONFIG_CLONER_RING_NUM;
+		cloner->ack_pending = 1;
+		cloner->ack = cloner->pipe_err;
+		return;
+	}
+#endif
+	cloner->ack = cloner_program(cloner);
 }
 
 #ifdef CONFIG_FPGA
@@ -435,11 +624,23 @@ void handle_cmd(struct usb_ep *ep,struct usb_request *req)
 			usb_ep_queue(cloner->ep_out, cloner->args_req, 0);
 			break;
 		case VR_WRITE:
-			realloc_buf(cloner, cmd->write.length);
+#ifdef CONFIG_CLONER_PIPELINE
+			if (cloner_can_defer(cmd->write.ops) &&
+			    !cloner_queue_slot(cloner, cmd))
+				break;
+			cloner_pipe_flush(cloner);
+#endif
+			if (!realloc_buf(cloner, cmd->write.length)) {
+				cloner->ack = -ENOMEM;
+				break;
+			}
 			cloner->write_req->length = cmd->write.length;
 			usb_ep_queue(cloner->ep_out, cloner->write_req, 0);
 			break;
 		case VR_INIT:
+#ifdef CONFIG_CLONER_PIPELINE
+			cloner->pipe_err = 0;
+#endif
 			if(!cloner->inited) {
 				cloner->ack = -EBUSY;
 				cloner_init(cloner);
@@ -502,6 +703,32 @@ int f_cloner_setup_handle(struct usb_function *f,
 	usb_ep_dequeue(cloner->ep0, cloner->ep0req);
 	usb_ep_dequeue(cloner->ep_in, cloner->read_req);
 	usb_ep_dequeue(cloner->ep_out, cloner->write_req);
+#ifdef CONFIG_CLONER_PIPELINE
+	{
+		int i;
+
+		for (i = 0; i < CONFIG_CLONER_RING_NUM; i++) {
+			if (cloner->slot[i].queued)
+				usb_ep_dequeue(cloner->ep_out, cloner->slot[i].req);
+			cloner->slot[i].queued = 0;
+		}
+	}
+
+	/*
+	 * Only VR_WRITE and the ack of the chunk just received may run ahead
+	 * of the programming.  Anything else, or asking for the same ack
+	 * twice, waits until all chunks are on the flash.
+	 */
+	if (ctlreq->bRequest == VR_GET_ACK) {
+		if (!cloner->ack_pending)
+			cloner_pipe_flush(cloner);
+		cloner->ack_pending = 0;
+		if (!cloner->ack)
+			cloner->ack = cloner->pipe_err;
+	} else if (ctlreq->bRequest != VR_WRITE) {
+		cloner_pipe_flush(cloner);
+	}
+#endif
 
 	cloner->cmd_type = ctlreq->bRequest;
 	req->length = ctlreq->wLength;
@@ -581,7 +808,9 @@ int f_cloner_bind(struct usb_configuration *c,
 	cloner->read_req = usb_ep_alloc_request(cloner->ep_in,0);
 
 	cloner->buf_size = 1024*1024;
-	cloner->buf = malloc(1024*1024);
+	cloner->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, 1024*1024);
+	if (!cloner->buf)
+		return -ENOMEM;
 	cloner->write_req->complete = handle_write;
 	cloner->write_req->buf = cloner->buf;
 	cloner->write_req->length = 1024*1024;
@@ -597,6 +826,25 @@ int f_cloner_bind(struct usb_configuration *c,
 	cloner->read_req->length = 1024*1024;
 	cloner->read_req->context = cloner;
 
+#ifdef CONFIG_CLONER_PIPELINE
+	{
+		int i;
+
+		/*
+		 * The slot buffers are allocated on the first VR_WRITE, a slot
+		 * without a request makes the writes go unpipelined.
+		 */
+		for (i = 0; i < CONFIG_CLONER_RING_NUM; i++) {
+			cloner->slot[i].req = usb_ep_alloc_request(cloner->ep_out,0);
+			if (!cloner->slot[i].req)
+				continue;
+			cloner->slot[i].req->complete = handle_write;
+			cloner->slot[i].req->context = cloner;
+		}
+		pipe_cloner = cloner;
+	}
+#endif
+
 	return 0;
 }
 
@@ -0,0 +1,536 @@
+/*
+ * Fastboot flash writer
+ *
+ * Writes a raw or Android sparse image to a partition straight through
+ * the driver of the boot medium (MMC, SFC NOR or MTD NAND). The image can
+ * be fed while it is being downloaded, so it never has to fit in RAM.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fastboot.h>
+#include <sparse_format.h>
+
+enum {
+	FB_HEAD,	/* sparse header or the start of a raw image */
+	FB_RAW,		/* not sparse, everything goes out as is */
+	FB_CHUNK,	/* chunk header */
+	FB_DATA,	/* raw chunk data */
+	FB_FILL,	/* fill chunk value */
+	FB_DONE,	/* past the last chunk */
+};
+
+#if defined(CONFIG_SPL_MMC_SUPPORT)
+#include <mmc.h>
+
+#define FB_MMC_DEV	0
+
+static int fb_dev_open(struct fb_flash *ff)
+{
+	struct mmc *mmc = find_mmc_device(FB_MMC_DEV);
+
+	if (!mmc || mmc_init(mmc))
+		return -ENODEV;
+	ff->unit = mmc->block_dev.blksz;
+	return 0;
+}
+
+static int fb_dev_write(struct fb_flash *ff, unsigned long off, void *buf,
+			unsigned int len)
+{
+	block_dev_desc_t *dev = &find_mmc_device(FB_MMC_DEV)->block_dev;
+	lbaint_t blk = (ff->part->offset + off) / dev->blksz;
+	lbaint_t cnt = len / dev->blksz;
+
+	if (dev->block_write(FB_MMC_DEV, blk, cnt, buf) != cnt)
+		return -EIO;
+	return 0;
+}
+
+static int fb_dev_erase(struct partition_info *part)
+{
+	struct mmc *mmc = find_mmc_device(FB_MMC_DEV);
+	block_dev_desc_t *dev;
+	lbaint_t cnt;
+
+	if (!mmc || mmc_init(mmc))
+		return -ENODEV;
+	dev = &mmc->block_dev;
+	cnt = part->size / dev->blksz;
+	if (dev->block_erase(FB_MMC_DEV, part->offset / dev->blksz, cnt) != cnt)
+		return -EIO;
+	return 0;
+}
+
+#elif defined(CONFIG_JZ_SFC_NOR)
+#include <asm/arch/sfc.h>
+
+/* the smallest NOR erase, and the block size of the sparse images */
+#define FB_NOR_ERASE	4096
+
+static int fb_dev_open(struct fb_flash *ff)
+{
+	ff->unit = FB_NOR_ERASE;
+	return 0;
+}
+
+/*
+ * jz_sfc_erase() picks one erase size for a whole call and rounds the
+ * length up to it: 68 KB at a 64 KB boundary would erase 128 KB, wiping
+ * a don't care region after the data. Erase in calls it serves exactly.
+ */
+static int fb_nor_erase(unsigned int off, unsigned int len)
+{
+	unsigned int n;
+
+	len = ALIGN(len, FB_NOR_ERASE);
+	while (len) {
+		if (!(off % 0x10000) && len >= 0x10000)
+			n = 0x10000;
+		else if (!(off % 0x8000) && len >= 0x8000)
+			n = 0x8000;
+		else
+			n = FB_NOR_ERASE;
+		if (sfc_nor_erase(off, n))
+			return -EIO;
+		off += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int fb_dev_write(struct fb_flash *ff, unsigned long off, void *buf,
+			unsigned int len)
+{
+	unsigned int addr = ff->part->offset + off;
+
+	if (fb_nor_erase(addr, len) ||
+	    sfc_nor_write(addr, len, (unsigned int)buf, 0))
+		return -EIO;
+	return 0;
+}
+
+static int fb_dev_erase(struct partition_info *part)
+{
+	return fb_nor_erase(part->offset, part->size) ? -EIO : 0;
+}
+
+#elif defined(CONFIG_CMD_NAND) && !defined(CONFIG_JZ_NAND_MGR)
+#include <nand.h>
+
+#define fb_nand()	(&nand_info[nand_curr_device])
+
+static int fb_dev_open(struct fb_flash *ff)
+{
+	nand_info_t *nand = fb_nand();
+
+	if (!nand->erasesize)
+		return -ENODEV;
+	ff->unit = nand->writesize;
+	return 0;
+}
+
+/* offset in the partition of the good block holding logical block @lblk */
+static int fb_nand_map(struct fb_flash *ff, unsigned long lblk,
+		       unsigned long *pofs)
+{
+	nand_info_t *nand = fb_nand();
+
+	if (lblk < ff->map_lblk) {
+		ff->map_lblk = 0;
+		ff->map_pofs = 0;
+	}
+
+	for (;;) {
+		if (ff->map_pofs >= ff->part->size)
+			return -ENOSPC;
+		if (nand_block_isbad(nand, ff->part->offset + ff->map_pofs)) {
+			ff->map_pofs += nand->erasesize;
+			continue;
+		}
+		if (ff->map_lblk == lblk)
+			break;
+		ff->map_lblk++;
+		ff->map_pofs += nand->erasesize;
+	}
+
+	*pofs = ff->map_pofs;
+	return 0;
+}
+
+/*
+ * A block is erased the first time a pass writes to it. The host sends a
+ * big sparse image in several passes, an earlier one may have written the
+ * head of the block already: that is read back and written again after
+ * the erase.
+ */
+static int fb_dev_write(struct fb_flash *ff, unsigned long off, void *buf,
+			unsigned int len)
+{
+	nand_info_t *nand = fb_nand();
+	unsigned long lblk, pofs;
+	loff_t addr;
+	size_t head, n;
+	int err;
+
+	while (len) {
+		lblk = off / nand->erasesize;
+		head = off % nand->erasesize;
+		n = min((size_t)len, (size_t)(nand->erasesize - head));
+
+		err = fb_nand_map(ff, lblk, &pofs);
+		if (err)
+			return err;
+		addr = ff->part->offset + pofs;
+
+		if (lblk >= ff->erased) {
+			if (head) {
+				if (!ff->blk_buf)
+					ff->blk_buf = malloc(nand->erasesize);
+				if (!ff->blk_buf)
+					return -ENOMEM;
+				err = nand_read(nand, addr, &head, ff->blk_buf);
+				if (err && !mtd_is_bitflip(err))
+					return err;
+			}
+			err = nand_erase(nand, addr, nand->erasesize);
+			if (err)
+				return err;
+			if (head) {
+				err = nand_write(nand, addr, &head, ff->blk_buf);
+				if (err)
+					return err;
+			}
+			ff->erased = lblk + 1;
+		}
+
+		err = nand_write(nand, addr + off % nand->erasesize, &n, buf);
+		if (err)
+			return err;
+
+		off += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int fb_dev_erase(struct partition_info *part)
+{
+	nand_erase_options_t opts;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.offset = part->offset;
+	opts.length = part->size;
+	opts.quiet = 1;
+
+	return nand_erase_opts(fb_nand(), &opts) ? -EIO : 0;
+}
+
+#else
+static int fb_dev_open(struct fb_flash *ff)
+{
+	return -ENODEV;
+}
+
+static int fb_dev_write(struct fb_flash *ff, unsigned long off, void *buf,
+			unsigned int len)
+{
+	return -ENODEV;
+}
+
+static int fb_dev_erase(struct partition_info *part)
+{
+	return -ENODEV;
+}
+#endif
+
+/* write the buffer out, only the tail of a raw image is not whole units */
+static int fb_flush(struct fb_flash *ff)
+{
+	unsigned int len = ff->buf_len;
+	int err;
+
+	if (!len)
+		return 0;
+
+	if (len % ff->unit) {
+		memset(ff->buf + len, 0xff, ff->unit - len % ff->unit);
+		len += ff->unit - len % ff->unit;
+	}
+
+	err = fb_dev_write(ff, ff->buf_off, ff->buf, len);
+	ff->buf_off = ff->off;
+	ff->buf_len = 0;
+	return err;
+}
+
+/* queue @len bytes of @data, or of the 32 bit pattern @fill if no @data */
+static int fb_put(struct fb_flash *ff, const unsigned char *data, u32 fill,
+		  unsigned long len)
+{
+	unsigned int n, i;
+	int err;
+
+	if (len > ff->part->size - ff->off)
+		return -ENOSPC;
+
+	while (len) {
+		if (ff->buf_len == CONFIG_FASTBOOT_FLASH_BUF) {
+			err = fb_flush(ff);
+			if (err)
+				return err;
+		}
+
+		n = min(len, (unsigned long)(CONFIG_FASTBOOT_FLASH_BUF -
+					     ff->buf_len));
+		if (data) {
+			memcpy(ff->buf + ff->buf_len, data, n);
+			data += n;
+		} else {
+			for (i = 0; i < n; i += 4)
+				*(u32 *)(ff->buf + ff->buf_len + i) = fill;
+		}
+		ff->buf_len += n;
+		ff->off += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* a don't care run, left as it is on the device */
+static int fb_hole(struct fb_flash *ff, unsigned long len)
+{
+	int err;
+
+	if (len > ff->part->size - ff->off)
+		return -ENOSPC;
+
+	err = fb_flush(ff);
+	ff->off += len;
+	ff->buf_off = ff->off;
+	return err;
+}
+
+static void fb_chunk_done(struct fb_flash *ff)
+{
+	ff->state = ff->chunks ? FB_CHUNK : FB_DONE;
+}
+
+static int fb_sparse_head(struct fb_flash *ff)
+{
+	sparse_header_t *sh = (sparse_header_t *)ff->hdr;
+	unsigned int file_hdr_sz = le16_to_cpu(sh->file_hdr_sz);
+
+	ff->chunk_hdr_sz = le16_to_cpu(sh->chunk_hdr_sz);
+	ff->blk_sz = le32_to_cpu(sh->blk_sz);
+	ff->chunks = le32_to_cpu(sh->total_chunks);
+
+	if (le16_to_cpu(sh->major_version) != 1 ||
+	    file_hdr_sz < sizeof(sparse_header_t) ||
+	    ff->chunk_hdr_sz < sizeof(chunk_header_t) ||
+	    !ff->blk_sz || ff->blk_sz % 4 || ff->blk_sz % ff->unit) {
+		printf("unsupported sparse image, version %u, block %u\n",
+		       le16_to_cpu(sh->major_version), ff->blk_sz);
+		return -EINVAL;
+	}
+
+	printf("sparse image, %u blocks of %u bytes in %u chunks\n",
+	       le32_to_cpu(sh->total_blks), ff->blk_sz, ff->chunks);
+
+	ff->skip = file_hdr_sz - sizeof(sparse_header_t);
+	fb_chunk_done(ff);
+	return 0;
+}
+
+static int fb_chunk_head(struct fb_flash *ff)
+{
+	chunk_header_t *ch = (chunk_header_t *)ff->hdr;
+	unsigned int type = le16_to_cpu(ch->chunk_type);
+	unsigned int blks = le32_to_cpu(ch->chunk_sz);
+	unsigned int data = le32_to_cpu(ch->total_sz) - ff->chunk_hdr_sz;
+	unsigned long size;
+
+	if (blks > ff->part->size / ff->blk_sz)
+		return -ENOSPC;
+	size = blks * ff->blk_sz;
+
+	ff->skip = ff->chunk_hdr_sz - sizeof(chunk_header_t);
+	ff->chunks--;
+
+	switch (type) {
+	case CHUNK_TYPE_RAW:
+		if (data != size)
+			break;
+		ff->need = size;
+		ff->state = FB_DATA;
+		if (!size)
+			fb_chunk_done(ff);
+		return 0;
+	case CHUNK_TYPE_FILL:
+		if (data != 4)
+			break;
+		ff->need = size;
+		ff->state = FB_FILL;
+		return 0;
+	case CHUNK_TYPE_DONT_CARE:
+		if (data)
+			break;
+		fb_chunk_done(ff);
+		return fb_hole(ff, size);
+	case CHUNK_TYPE_CRC32:
+		if (data != 4)
+			break;
+		ff->skip += 4;
+		fb_chunk_done(ff);
+		return 0;
+	}
+
+	printf("bad sparse chunk %04x, %u blocks, %u bytes\n", type, blks, data);
+	return -EINVAL;
+}
+
+/*
+ * Feed the next @len bytes of the image. After an error the rest of the
+ * image is dropped, the error is returned here and by fb_flash_close().
+ */
+int fb_flash_write(struct fb_flash *ff, const void *data, unsigned int len)
+{
+	const unsigned char *p = data;
+	unsigned int n, want;
+	int err = 0;
+
+	while (len && !ff->err) {
+		if (ff->skip) {
+			n = min(len, ff->skip);
+			ff->skip -= n;
+			p += n;
+			len -= n;
+			continue;
+		}
+
+		switch (ff->state) {
+		case FB_HEAD:
+		case FB_CHUNK:
+		case FB_FILL:
+			if (ff->state == FB_HEAD)
+				want = sizeof(sparse_header_t);
+			else if (ff->state == FB_CHUNK)
+				want = sizeof(chunk_header_t);
+			else
+				want = 4;
+
+			n = min(len, want - ff->hdr_len);
+			memcpy((unsigned char *)ff->hdr + ff->hdr_len, p, n);
+			ff->hdr_len += n;
+			p += n;
+			len -= n;
+
+			if (ff->state == FB_HEAD && ff->hdr_len >= 4 &&
+			    le32_to_cpu(ff->hdr[0]) != SPARSE_HEADER_MAGIC) {
+				ff->state = FB_RAW;
+				err = fb_put(ff, (unsigned char *)ff->hdr, 0,
+					     ff->hdr_len);
+				break;
+			}
+			if (ff->hdr_len < want)
+				break;
+			ff->hdr_len = 0;
+
+			if (ff->state == FB_HEAD) {
+				err = fb_sparse_head(ff);
+			} else if (ff->state == FB_CHUNK) {
+				err = fb_chunk_head(ff);
+			} else {
+				/* the pattern is stored in file byte order */
+				err = fb_put(ff, NULL, ff->hdr[0], ff->need);
+				fb_chunk_done(ff);
+			}
+			break;
+		case FB_RAW:
+			err = fb_put(ff, p, 0, len);
+			len = 0;
+			break;
+		case FB_DATA:
+			n = min(len, ff->need);
+			err = fb_put(ff, p, 0, n);
+			ff->need -= n;
+			p += n;
+			len -= n;
+			if (!ff->need)
+				fb_chunk_done(ff);
+			break;
+		case FB_DONE:
+			printf("%u bytes past the last sparse chunk\n", len);
+			err = -EINVAL;
+			break;
+		}
+
+		if (err)
+			ff->err = err;
+	}
+
+	return ff->err;
+}
+
+int fb_flash_open(struct fb_flash *ff, struct partition_info *part)
+{
+	memset(ff, 0, sizeof(*ff));
+	ff->part = part;
+	ff->state = FB_HEAD;
+
+	ff->err = fb_dev_open(ff);
+	if (ff->err) {
+		printf("no flash device for %s\n", part->pname);
+		return ff->err;
+	}
+
+	ff->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, CONFIG_FASTBOOT_FLASH_BUF);
+	if (!ff->buf)
+		ff->err = -ENOMEM;
+	return ff->err;
+}
+
+int fb_flash_close(struct fb_flash *ff)
+{
+	int err = ff->err;
+
+	/* less than the magic, too short to be sparse */
+	if (!err && ff->state == FB_HEAD && ff->hdr_len < 4)
+		err = fb_put(ff, (unsigned char *)ff->hdr, 0, ff->hdr_len);
+	else if (!err && ff->state != FB_RAW && ff->state != FB_DONE) {
+		printf("sparse image truncated\n");
+		err = -EINVAL;
+	}
+	if (!err)
+		err = fb_flush(ff);
+
+	if (err)
+		printf("flashing %s failed, error %d\n", ff->part->pname, err);
+	else
+		printf("%s: %lu bytes written\n", ff->part->pname, ff->off);
+
+	free(ff->buf);
+	free(ff->blk_buf);
+	ff->buf = NULL;
+	ff->blk_buf = NULL;
+	return err;
+}
+
+int fb_flash_erase(struct partition_info *part)
+{
+	return fb_dev_erase(part);
+}
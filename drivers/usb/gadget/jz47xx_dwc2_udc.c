@@ -1278,9 +1278,51 @@ int usb_gadget_unregister_driver(struct usb_gadget_driver *driver)
 }
 
 
+/*
+ * Called from the poll loop when the controller has nothing pending, gadget
+ * functions may use it for deferred work.
+ */
+void __weak usb_gadget_idle(void)
+{
+}
+
+/*
+ * Receive for the OUT endpoints other than ep0 and complete their requests,
+ * stop at the first ep0 entry of the RX FIFO.  For a gadget function busy
+ * in a long job, setup packets wait until it is back in the poll loop.
+ */
+void usb_gadget_poll_out(void)
+{
+	struct dwc2_udc *dev = the_controller;
+	u32 intr, ep_pending;
+	int epnum;
+
+	if (usb_poll_active != true)
+		return;
+
+	while ((udc_read_reg(GINT_STS) & GINTSTS_RXFIFO_NEMPTY) &&
+	       (udc_read_reg(GRXSTS_READ) & 0xf))
+		handle_rxfifo_nempty(dev, 0);
+
+	intr = (udc_read_reg(OTG_DAINT) & DAINT_OUT_MASK) >> DAINT_OUT_BIT;
+	for (epnum = 1; epnum <= DWC2_MAX_OUT_ENDPOINTS; epnum++) {
+		if (!(intr & (0x1 << epnum)))
+			continue;
+		ep_pending = udc_read_reg(DOEP_INT(epnum)) & udc_read_reg(DOEP_MASK);
+		if (ep_pending & DEP_XFER_COMP) {
+			outepx_transfer_complete(dev->ep_out_attr[epnum]);
+			udc_write_reg(DEP_XFER_COMP, DOEP_INT(epnum));
+		}
+	}
+}
+
 int usb_gadget_handle_interrupts(void)
 {
-	if (usb_poll_active == true)
-		udc_irq();
+	if (usb_poll_active == true) {
+		if (udc_read_reg(GINT_STS) & udc_read_reg(GINT_MASK))
+			udc_irq();
+		else
+			usb_gadget_idle();
+	}
 	return 0;
 }
@@ -29,13 +29,15 @@
 #include <asm/arch/gpio.h>
 #include <asm/arch/clk.h>
 #include <jz_lcd/jz_lcd_v13.h>
+#ifdef CONFIG_JZ_PDMA
+#include <asm/arch/dma.h>
+#endif
 
 /* #define DEBUG */
 
 struct jzfb_config_info lcd_config_info;
 static int lcd_enable_state = 0;
 void board_set_lcd_power_on(void);
-void flush_cache_all(void);
 void lcd_close_backlight(void);
 void lcd_set_backlight_level(int num);
 #define reg_write(addr,config)				\
@@ -157,43 +159,77 @@ void dump_lcd_reg()
 #endif
 
 #if defined(CONFIG_LCD_LOGO)
-static void fbmem_set(void *_ptr, unsigned short val, unsigned count)
+/* a 565 pixel the way the framebuffer stores it, twice over at 16bpp */
+static unsigned int fbmem_pixel(unsigned short val, int bpp)
 {
-	int bpp = NBITS(panel_info.vl_bpix);
-	if(bpp == 16){
-		unsigned short *ptr = _ptr;
+	int alpha, rdata, gdata, bdata;
 
-		while (count--)
-			*ptr++ = val;
-	} else if (bpp == 32){
-		int val_32;
-		int alpha, rdata, gdata, bdata;
-		unsigned int *ptr = (unsigned int *)_ptr;
+	if (bpp == 16)
+		return val | val << 16;
 
-		alpha = 0xff;
+	alpha = 0xff;
 
-		rdata = val >> 11;
-		rdata = (rdata << 3) | 0x7;
+	rdata = val >> 11;
+	rdata = (rdata << 3) | 0x7;
 
-		gdata = (val >> 5) & 0x003F;
-		gdata = (gdata << 2) | 0x3;
+	gdata = (val >> 5) & 0x003F;
+	gdata = (gdata << 2) | 0x3;
 
-		bdata = val & 0x001F;
-		bdata = (bdata << 3) | 0x7;
+	bdata = val & 0x001F;
+	bdata = (bdata << 3) | 0x7;
 
-		if (lcd_config_info.fmt_order == FORMAT_X8B8G8R8) {
-			val_32 =
-				(alpha << 24) | (bdata << 16) | (gdata << 8) | rdata;
-			/*fixed */
-		} else if (lcd_config_info.fmt_order == FORMAT_X8R8G8B8) {
-			val_32 =
-				(alpha << 24) | (rdata << 16) | (gdata << 8) | bdata;
-		}
+	if (lcd_config_info.fmt_order == FORMAT_X8B8G8R8)
+		return (alpha << 24) | (bdata << 16) | (gdata << 8) | rdata;
+	return (alpha << 24) | (rdata << 16) | (gdata << 8) | bdata;
+}
 
-		while (count--){
-			*ptr++ = val_32;
+/*
+ * Expand one RLE run with word stores, converting to the framebuffer
+ * format on the way. Runs long enough go to the PDMA.
+ */
+static void fbmem_set(void *_ptr, unsigned short val, unsigned count)
+{
+	int bpp = NBITS(panel_info.vl_bpix);
+	unsigned int pixel = fbmem_pixel(val, bpp);
+	unsigned int *ptr;
+
+	if (bpp == 16) {
+		unsigned short *ptr16 = _ptr;
+
+		if (count && ((unsigned long)ptr16 & 2)) {
+			*ptr16++ = val;
+			count--;
 		}
+		if (count & 1)
+			ptr16[count - 1] = val;
+		ptr = (unsigned int *)ptr16;
+		count >>= 1;
+	} else if (bpp == 32) {
+		ptr = _ptr;
+	} else {
+		return;
+	}
+
+#ifdef CONFIG_JZ_PDMA
+	if (count * 4 >= CONFIG_JZ_PDMA_THRESHOLD) {
+		dma_memset32(ptr, pixel, count * 4);
+		return;
 	}
+#endif
+	while (count >= 8) {
+		ptr[0] = pixel;
+		ptr[1] = pixel;
+		ptr[2] = pixel;
+		ptr[3] = pixel;
+		ptr[4] = pixel;
+		ptr[5] = pixel;
+		ptr[6] = pixel;
+		ptr[7] = pixel;
+		ptr += 8;
+		count -= 8;
+	}
+	while (count--)
+		*ptr++ = pixel;
 }
 /* 565RLE image format: [count(2 bytes), rle(2 bytes)] */
 void rle_plot_biger(unsigned short *src_buf, unsigned short *dst_buf, int bpp)
@@ -511,26 +547,51 @@ void rle_plot(unsigned short *buf, unsigned char *dst_buf)
 {
 }
 #endif
+/*
+ * Write the framebuffer back and, on a smart panel without continuous
+ * refresh, send it out as a new frame.
+ */
+void fb_flush(void *fb_addr, int count)
+{
+#ifndef CONFIG_SLCDC_CONTINUA
+	int smart_ctrl = 0;
+#endif
+
+	flush_dcache_range((ulong)fb_addr, (ulong)fb_addr + count);
+#ifndef CONFIG_SLCDC_CONTINUA
+	smart_ctrl = reg_read(SLCDC_CTRL);
+	smart_ctrl |= SLCDC_CTRL_DMA_START; //trigger a new frame
+	reg_write(SLCDC_CTRL, smart_ctrl);
+#endif
+}
+
 void fb_fill(void *logo_addr, void *fb_addr, int count)
 {
-	//memcpy(logo_buf, fb_addr, count);
+#ifdef CONFIG_JZ_PDMA
+	dma_memcpy(fb_addr, logo_addr, ALIGN(count, 4));
+#else
 	int i;
 	int *dest_addr = (int *)fb_addr;
 	int *src_addr = (int *)logo_addr;
-#ifndef CONFIG_SLCDC_CONTINUA
-        int smart_ctrl = 0;
-#endif
+
 	for(i = 0; i < count; i = i + 4){
 		*dest_addr =  *src_addr;
 		src_addr++;
 		dest_addr++;
 	}
-#ifndef CONFIG_SLCDC_CONTINUA
-        smart_ctrl = reg_read(SLCDC_CTRL);
-        smart_ctrl |= SLCDC_CTRL_DMA_START; //trigger a new frame
-        reg_write(SLCDC_CTRL, smart_ctrl);
 #endif
+	fb_flush(fb_addr, count);
+}
 
+/* clear the framebuffer in place, no staging buffer */
+void fb_clear(void *fb_addr, int count)
+{
+#ifdef CONFIG_JZ_PDMA
+	dma_memset(fb_addr, 0, count);
+#else
+	memset(fb_addr, 0, count);
+#endif
+	fb_flush(fb_addr, count);
 }
 
 int jzfb_get_controller_bpp(unsigned int bpp)
@@ -689,8 +750,6 @@ static void jzfb_config_smart_lcd_dma(struct jzfb_config_info *info)
 	}
 
 	info->fdadr0 = virt_to_phys((void *)info->dmadesc_cmd_tmp);
-
-	flush_cache_all();
 }
 
 static void jzfb_config_fg1_dma(struct jzfb_config_info *info)
@@ -726,7 +785,12 @@ static void jzfb_config_fg1_dma(struct jzfb_config_info *info)
 
 	framedesc->desc_size |= 0xff << LCDC_DESSIZE_ALPHA_BIT;
 
-	flush_cache_all();
+	/*
+	 * fg1 is set up last: flush all four descriptors, which sit back to
+	 * back from cmd_tmp up to the palette.
+	 */
+	flush_dcache_range((ulong)info->dmadesc_cmd_tmp,
+			   (ulong)(info->dmadesc_fbhigh + 1));
 	reg_write(LCDC_DA1, framedesc->fdadr);
 }
 
@@ -1110,7 +1174,7 @@ static int jz_lcd_init_mem(void *lcdbase, struct jzfb_config_info *info)
 		for (i = 0; i < info->smart_config.length_cmd; i++) {
 			ptr[i] = info->smart_config.write_gram_cmd[i];
 		}
-		flush_cache_all();
+		flush_dcache_range((ulong)ptr, (ulong)(ptr + i));
 	}
 	return 0;
 }
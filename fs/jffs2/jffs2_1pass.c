@@ -389,6 +389,153 @@ static inline void *get_node_mem_nor(u32 off, void *ext_buf)
 }
 #endif
 
+#if defined(CONFIG_JZ_SFC_NOR) && !defined(CONFIG_CMD_FLASH)
+#include <asm/arch/sfc.h>
+/*
+ * Support for jffs2 on top of SFC NOR-flash
+ *
+ * The SFC NOR isn't mapped either, nodes are fetched through a window
+ * filled with sfc_nor_read().  While the lists are built the window is the
+ * whole erase block the scan has just read, see get_fl_block().  Offsets
+ * inside the SFC NOR shadow are served from there, like mapped NOR.
+ */
+
+#ifndef SFC_NOR_CACHE_SIZE
+#define SFC_NOR_CACHE_SIZE 4096
+#endif
+
+extern int sfc_nor_read(unsigned int src_addr, unsigned int count,
+			unsigned int dst_addr);
+
+static u8 *sfc_nor_cache;
+static u8 *sfc_nor_win;
+static u32 sfc_nor_win_off = (u32)-1;
+static u32 sfc_nor_win_len;
+
+static int read_sfc_nor_cached(u32 off, u32 size, u_char *buf)
+{
+	u32 bytes_read = 0;
+	int cpy_bytes;
+
+	while (bytes_read < size) {
+		if ((off + bytes_read < sfc_nor_win_off) ||
+		    (off + bytes_read >= sfc_nor_win_off + sfc_nor_win_len)) {
+			if (!sfc_nor_cache) {
+				sfc_nor_cache = memalign(ARCH_DMA_MINALIGN,
+							 SFC_NOR_CACHE_SIZE);
+				if (!sfc_nor_cache) {
+					printf("read_sfc_nor_cached: can't alloc cache size %d bytes\n",
+					       SFC_NOR_CACHE_SIZE);
+					return -1;
+				}
+			}
+
+			sfc_nor_win = sfc_nor_cache;
+			sfc_nor_win_len = SFC_NOR_CACHE_SIZE;
+			sfc_nor_win_off = (off + bytes_read) &
+					  ~(SFC_NOR_CACHE_SIZE - 1);
+			if (sfc_nor_read(sfc_nor_win_off, SFC_NOR_CACHE_SIZE,
+					 (u32)sfc_nor_cache)) {
+				printf("read_sfc_nor_cached: error reading nor off %#x size %d bytes\n",
+				       sfc_nor_win_off, SFC_NOR_CACHE_SIZE);
+				sfc_nor_win_off = (u32)-1;
+				return -1;
+			}
+		}
+		cpy_bytes = sfc_nor_win_off + sfc_nor_win_len - (off + bytes_read);
+		if (cpy_bytes > size - bytes_read)
+			cpy_bytes = size - bytes_read;
+		memcpy(buf + bytes_read,
+		       sfc_nor_win + off + bytes_read - sfc_nor_win_off,
+		       cpy_bytes);
+		bytes_read += cpy_bytes;
+	}
+	return bytes_read;
+}
+
+static void *get_fl_mem_nor(u32 off, u32 size, void *ext_buf)
+{
+	u_char *buf;
+
+#ifdef CONFIG_SFC_NOR_SHADOW
+	buf = sfc_nor_map(off, size);
+	if (buf) {
+		if (!ext_buf)
+			return buf;
+		memcpy(ext_buf, buf, size);
+		return ext_buf;
+	}
+#endif
+
+	buf = ext_buf ? (u_char *)ext_buf : (u_char *)malloc(size);
+	if (NULL == buf) {
+		printf("get_fl_mem_nor: can't alloc %d bytes\n", size);
+		return NULL;
+	}
+	if (read_sfc_nor_cached(off, size, buf) < 0) {
+		if (!ext_buf)
+			free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void *get_node_mem_nor(u32 off, void *ext_buf)
+{
+	struct jffs2_unknown_node node;
+	void *ret = NULL;
+
+	if (NULL == get_fl_mem_nor(off, sizeof(node), &node))
+		return NULL;
+
+	ret = get_fl_mem_nor(off, node.magic ==
+			JFFS2_MAGIC_BITMASK ? node.totlen : sizeof(node),
+			ext_buf);
+	if (!ret) {
+		printf("off = %#x magic %#x type %#x node.totlen = %d\n",
+		       off, node.magic, node.nodetype, node.totlen);
+	}
+	return ret;
+}
+
+/* one read for the whole block, the scan of it is then served from @buf */
+static int get_fl_block_nor(u32 off, u32 size, u_char *buf)
+{
+#ifdef CONFIG_SFC_NOR_SHADOW
+	u_char *map = sfc_nor_map(off, size);
+
+	if (map) {
+		memcpy(buf, map, size);
+		return 0;
+	}
+#endif
+	sfc_nor_win_off = (u32)-1;
+	if (sfc_nor_read(off, size, (u32)buf))
+		return -1;
+
+	sfc_nor_win = buf;
+	sfc_nor_win_off = off;
+	sfc_nor_win_len = size;
+	return 0;
+}
+
+static void put_fl_block_nor(u_char *buf)
+{
+	if (sfc_nor_win == buf)
+		sfc_nor_win_off = (u32)-1;
+}
+
+static void put_fl_mem_nor(void *buf)
+{
+#ifdef CONFIG_SFC_NOR_SHADOW
+	if (sfc_nor_in_shadow(buf))
+		return;
+#endif
+	free(buf);
+}
+#endif
+
 
 /*
  * Generic jffs2 raw memory and node read routines.
@@ -399,7 +546,7 @@ static inline void *get_fl_mem(u32 off, u32 size, void *ext_buf)
 	struct mtdids *id = current_part->dev->id;
 
 	switch(id->type) {
-#if defined(CONFIG_CMD_FLASH)
+#if defined(CONFIG_CMD_FLASH) || defined(CONFIG_JZ_SFC_NOR)
 	case MTD_DEV_TYPE_NOR:
 		return get_fl_mem_nor(off, size, ext_buf);
 		break;
@@ -426,7 +573,7 @@ static inline void *get_node_mem(u32 off, void *ext_buf)
 	struct mtdids *id = current_part->dev->id;
 
 	switch(id->type) {
-#if defined(CONFIG_CMD_FLASH)
+#if defined(CONFIG_CMD_FLASH) || defined(CONFIG_JZ_SFC_NOR)
 	case MTD_DEV_TYPE_NOR:
 		return get_node_mem_nor(off, ext_buf);
 		break;
@@ -458,6 +605,10 @@ static inline void put_fl_mem(void *buf, void *ext_buf)
 	if (buf == ext_buf)
 		return;
 	switch (id->type) {
+#if defined(CONFIG_JZ_SFC_NOR) && !defined(CONFIG_CMD_FLASH)
+	case MTD_DEV_TYPE_NOR:
+		return put_fl_mem_nor(buf);
+#endif
 #if defined(CONFIG_JFFS2_NAND) && defined(CONFIG_CMD_NAND)
 	case MTD_DEV_TYPE_NAND:
 		return put_fl_mem_nand(buf);
@@ -469,6 +620,29 @@ static inline void put_fl_mem(void *buf, void *ext_buf)
 	}
 }
 
+#ifdef CONFIG_JFFS2_NODE_INDEX
+/*
+ * Read a whole erase block into @buf.  The device may keep serving
+ * get_fl_mem() from it until put_fl_block().
+ */
+static int get_fl_block(u32 off, u32 size, u_char *buf)
+{
+#if defined(CONFIG_JZ_SFC_NOR) && !defined(CONFIG_CMD_FLASH)
+	if (current_part->dev->id->type == MTD_DEV_TYPE_NOR)
+		return get_fl_block_nor(off, size, buf);
+#endif
+	return get_fl_mem(off, size, buf) ? 0 : -1;
+}
+
+static void put_fl_block(u_char *buf)
+{
+#if defined(CONFIG_JZ_SFC_NOR) && !defined(CONFIG_CMD_FLASH)
+	if (current_part->dev->id->type == MTD_DEV_TYPE_NOR)
+		put_fl_block_nor(buf);
+#endif
+}
+#endif
+
 /* Compression names */
 static char *compr_names[] = {
 	"NONE",
@@ -1433,6 +1607,144 @@ static inline uint32_t EMPTY_SCAN_SIZE(uint32_t sector_size)
 		return DEFAULT_EMPTY_SCAN_SIZE;
 }
 
+#ifdef CONFIG_JFFS2_NODE_INDEX
+/*
+ * Inode and dirent offsets of every erase block, kept across rescans.  A
+ * block that still has the CRC it had when it was walked gets its nodes
+ * back from here instead of being walked again, so after a write to the
+ * partition only the blocks that changed are parsed.  Blocks that carry
+ * a summary don't need it and are not kept.
+ */
+struct jffs2_blk_index {
+	int valid;
+	u32 crc;
+	u32 max_totlen;
+	u32 nr_frag;
+	u32 nr_dir;
+	u32 *offs;		/* the inodes, then the dirents */
+};
+
+struct jffs2_index_rec {
+	u32 *offs;
+	u32 nr;
+	u32 max;
+};
+
+static struct {
+	struct mtdids *id;
+	u32 offset;
+	u32 size;
+	u32 sector_size;
+	struct jffs2_blk_index *blk;
+} jffs2_index;
+
+/* the nodes of the block being walked */
+static struct jffs2_index_rec rec_frag, rec_dir;
+static struct jffs2_blk_index *rec_blk;
+static u32 rec_max_totlen;
+
+/* the index of @part, dropped and started over if the partition moved */
+static struct jffs2_blk_index *jffs2_index_get(struct part_info *part)
+{
+	u32 i, nr_sectors = part->size / part->sector_size;
+
+	if (jffs2_index.blk && jffs2_index.id == part->dev->id &&
+	    jffs2_index.offset == part->offset &&
+	    jffs2_index.size == part->size &&
+	    jffs2_index.sector_size == part->sector_size)
+		return jffs2_index.blk;
+
+	if (jffs2_index.blk) {
+		for (i = 0; i < jffs2_index.size / jffs2_index.sector_size; i++)
+			free(jffs2_index.blk[i].offs);
+		free(jffs2_index.blk);
+	}
+
+	jffs2_index.blk = malloc(nr_sectors * sizeof(*jffs2_index.blk));
+	if (!jffs2_index.blk)
+		return NULL;
+	memset(jffs2_index.blk, 0, nr_sectors * sizeof(*jffs2_index.blk));
+	jffs2_index.id = part->dev->id;
+	jffs2_index.offset = part->offset;
+	jffs2_index.size = part->size;
+	jffs2_index.sector_size = part->sector_size;
+
+	return jffs2_index.blk;
+}
+
+static int jffs2_index_note(struct jffs2_index_rec *rec, u32 offset)
+{
+	u32 *offs;
+
+	if (rec->nr == rec->max) {
+		offs = realloc(rec->offs, (rec->max + 256) * sizeof(u32));
+		if (!offs)
+			return -1;
+		rec->offs = offs;
+		rec->max += 256;
+	}
+	rec->offs[rec->nr++] = offset;
+	return 0;
+}
+
+/* keep what the walk of rec_blk found, it is not kept if that fails */
+static void jffs2_index_store(void)
+{
+	struct jffs2_blk_index *blk = rec_blk;
+
+	rec_blk = NULL;
+	if (!blk)
+		return;
+
+	/* a block with no nodes is kept too, as nothing to replay */
+	blk->offs = NULL;
+	if (rec_frag.nr + rec_dir.nr) {
+		blk->offs = malloc((rec_frag.nr + rec_dir.nr) * sizeof(u32));
+		if (!blk->offs)
+			return;
+		memcpy(blk->offs, rec_frag.offs, rec_frag.nr * sizeof(u32));
+		memcpy(blk->offs + rec_frag.nr, rec_dir.offs,
+		       rec_dir.nr * sizeof(u32));
+	}
+	blk->nr_frag = rec_frag.nr;
+	blk->nr_dir = rec_dir.nr;
+	blk->max_totlen = rec_max_totlen;
+	blk->valid = 1;
+}
+
+/* put the nodes of an unchanged block on the lists */
+static int jffs2_index_replay(struct b_lists *pL, struct jffs2_blk_index *blk)
+{
+	u32 i;
+
+	for (i = 0; i < blk->nr_frag; i++)
+		if (insert_node(&pL->frag, blk->offs[i]) == NULL)
+			return -1;
+	for (i = 0; i < blk->nr_dir; i++)
+		if (insert_node(&pL->dir, blk->offs[blk->nr_frag + i]) == NULL)
+			return -1;
+	return 0;
+}
+#endif
+
+/* insert_node() for the walk, noting the node for the index */
+static struct b_node *
+scan_insert_node(struct b_lists *pL, struct b_list *list, u32 offset,
+		 u32 totlen)
+{
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	if (rec_max_totlen < totlen)
+		rec_max_totlen = totlen;
+	if (rec_blk && jffs2_index_note(list == &pL->frag ? &rec_frag : &rec_dir,
+					offset)) {
+		/* no room to remember this block, it is walked next time */
+		rec_blk->valid = 0;
+		rec_blk = NULL;
+	}
+#endif
+	return insert_node(list, offset);
+}
+
 static u32
 jffs2_1pass_build_lists(struct part_info * part)
 {
@@ -1446,6 +1758,11 @@ jffs2_1pass_build_lists(struct part_info * part)
 	u32 max_totlen = 0;
 	u32 buf_size = DEFAULT_EMPTY_SCAN_SIZE;
 	char *buf;
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	struct jffs2_blk_index *index;
+	u_char *blkbuf = NULL;
+	u32 reused = 0;
+#endif
 
 	/* turn off the lcd.  Refreshing the lcd adds 50% overhead to the */
 	/* jffs2 list building enterprise nope.  in newer versions the overhead is */
@@ -1456,6 +1773,12 @@ jffs2_1pass_build_lists(struct part_info * part)
 	jffs_init_1pass_list(part);
 	pL = (struct b_lists *)part->jffs2_priv;
 	buf = malloc(buf_size);
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	index = jffs2_index_get(part);
+	if (index)
+		blkbuf = memalign(ARCH_DMA_MINALIGN, part->sector_size);
+	rec_blk = NULL;
+#endif
 	puts ("Scanning JFFS2 FS:   ");
 
 	/* start at the beginning of the partition */
@@ -1472,6 +1795,9 @@ jffs2_1pass_build_lists(struct part_info * part)
 #endif
 
 		WATCHDOG_RESET();
+#ifdef CONFIG_JFFS2_NODE_INDEX
+		jffs2_index_store();
+#endif
 
 #ifdef CONFIG_JFFS2_SUMMARY
 		buf_len = sizeof(*sm);
@@ -1483,7 +1809,9 @@ jffs2_1pass_build_lists(struct part_info * part)
 				buf_len, buf_len, buf + buf_size - buf_len);
 
 		sm = (void *)buf + buf_size - sizeof(*sm);
-		if (sm->magic == JFFS2_SUM_MAGIC) {
+		/* a torn or foreign marker must not size the read below */
+		if (sm->magic == JFFS2_SUM_MAGIC &&
+		    sm->offset < part->sector_size - buf_len) {
 			sumlen = part->sector_size - sm->offset;
 			sumptr = buf + buf_size - sumlen;
 
@@ -1494,9 +1822,7 @@ jffs2_1pass_build_lists(struct part_info * part)
 				if (!sumptr) {
 					putstr("Can't get memory for summary "
 							"node!\n");
-					free(buf);
-					jffs2_free_cache(part);
-					return 0;
+					goto fail;
 				}
 				memcpy(sumptr + sumlen - buf_len, buf +
 						buf_size - buf_len, buf_len);
@@ -1517,11 +1843,8 @@ jffs2_1pass_build_lists(struct part_info * part)
 
 			if (buf_size && sumlen > buf_size)
 				free(sumptr);
-			if (ret < 0) {
-				free(buf);
-				jffs2_free_cache(part);
-				return 0;
-			}
+			if (ret < 0)
+				goto fail;
 			if (ret)
 				continue;
 
@@ -1543,6 +1866,30 @@ jffs2_1pass_build_lists(struct part_info * part)
 		if (ofs == EMPTY_SCAN_SIZE(part->sector_size))
 			continue;
 
+#ifdef CONFIG_JFFS2_NODE_INDEX
+		if (blkbuf && !get_fl_block((u32)part->offset + sector_ofs,
+					    part->sector_size, blkbuf)) {
+			struct jffs2_blk_index *blk = &index[i];
+			u32 crc = crc32_no_comp(0, blkbuf, part->sector_size);
+
+			if (blk->valid && blk->crc == crc) {
+				if (jffs2_index_replay(pL, blk))
+					goto fail;
+				if (max_totlen < blk->max_totlen)
+					max_totlen = blk->max_totlen;
+				reused++;
+				continue;
+			}
+			free(blk->offs);
+			blk->offs = NULL;
+			blk->valid = 0;
+			blk->crc = crc;
+			rec_frag.nr = rec_dir.nr = 0;
+			rec_max_totlen = 0;
+			rec_blk = blk;
+		}
+#endif
+
 		ofs += sector_ofs;
 		prevofs = ofs - 1;
 
@@ -1633,12 +1980,10 @@ jffs2_1pass_build_lists(struct part_info * part)
 				if (!inode_crc((struct jffs2_raw_inode *) node))
 				       break;
 
-				if (insert_node(&pL->frag, (u32) part->offset +
-						ofs) == NULL) {
-					free(buf);
-					jffs2_free_cache(part);
-					return 0;
-				}
+				if (scan_insert_node(pL, &pL->frag,
+						(u32) part->offset + ofs,
+						node->totlen) == NULL)
+					goto fail;
 				if (max_totlen < node->totlen)
 					max_totlen = node->totlen;
 				break;
@@ -1663,12 +2008,10 @@ jffs2_1pass_build_lists(struct part_info * part)
 					break;
 				if (! (counterN%100))
 					puts ("\b\b.  ");
-				if (insert_node(&pL->dir, (u32) part->offset +
-						ofs) == NULL) {
-					free(buf);
-					jffs2_free_cache(part);
-					return 0;
-				}
+				if (scan_insert_node(pL, &pL->dir,
+						(u32) part->offset + ofs,
+						node->totlen) == NULL)
+					goto fail;
 				if (max_totlen < node->totlen)
 					max_totlen = node->totlen;
 				counterN++;
@@ -1700,7 +2043,19 @@ jffs2_1pass_build_lists(struct part_info * part)
 	}
 
 	free(buf);
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	jffs2_index_store();
+	if (blkbuf) {
+		put_fl_block(blkbuf);
+		free(blkbuf);
+	}
+#endif
 	putstr("\b\b done.\r\n");		/* close off the dots */
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	if (reused)
+		printf("%u of %u erase blocks unchanged since the last scan\n",
+		       reused, nr_sectors);
+#endif
 
 	/* We don't care if malloc failed - then each read operation will
 	 * allocate its own buffer as necessary (NAND) or will read directly
@@ -1730,6 +2085,18 @@ jffs2_1pass_build_lists(struct part_info * part)
 	/* give visual feedback that we are done scanning the flash */
 	led_blink(0x0, 0x0, 0x1, 0x1);	/* off, forever, on 100ms, off 100ms */
 	return 1;
+
+fail:
+	free(buf);
+#ifdef CONFIG_JFFS2_NODE_INDEX
+	rec_blk = NULL;
+	if (blkbuf) {
+		put_fl_block(blkbuf);
+		free(blkbuf);
+	}
+#endif
+	jffs2_free_cache(part);
+	return 0;
 }
 
 
@@ -1767,6 +2134,10 @@ jffs2_get_list(struct part_info * part, const char *who)
 {
 	/* copy requested part_info struct pointer to global location */
 	current_part = part;
+#if defined(CONFIG_JZ_SFC_NOR) && !defined(CONFIG_CMD_FLASH)
+	/* the flash may have been written since the last command */
+	sfc_nor_win_off = (u32)-1;
+#endif
 
 	if (jffs2_1pass_rescan_needed(part)) {
 		if (!jffs2_1pass_build_lists(part)) {
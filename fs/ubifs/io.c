@@ -256,6 +256,70 @@ void ubifs_prepare_node(struct ubifs_info *c, void *node, int len, int pad)
 	}
 }
 
+#ifdef CONFIG_UBIFS_BULK_READ
+/**
+ * ubifs_ra_invalidate - drop the LEB read-ahead window.
+ * @c: UBIFS file-system description object
+ */
+void ubifs_ra_invalidate(struct ubifs_info *c)
+{
+	c->ra_lnum = -1;
+}
+
+/**
+ * ubifs_leb_read_ra - read through the LEB read-ahead window.
+ * @c: UBIFS file-system description object
+ * @lnum: logical eraseblock number
+ * @offs: offset within the logical eraseblock
+ * @len: how many bytes to read
+ * @data: pointer to the data within the window is returned here
+ *
+ * A miss reads everything from the min. I/O unit holding @offs to the end of
+ * the LEB in one go, so that the following bulk-reads of a sequentially
+ * written file are served from RAM and the flash is read at full bandwidth
+ * rather than one node at a time. The data is not copied, @data stays valid
+ * until the next call. Returns zero in case of success, %-EBADMSG if the data
+ * may be corrupted (the nodes still have to be checked, as with 'ubi_read()')
+ * and a negative error code in case of failure.
+ */
+int ubifs_leb_read_ra(struct ubifs_info *c, int lnum, int offs, int len,
+		      void **data)
+{
+	int err, start;
+
+	ubifs_assert(offs >= 0 && len >= 0 && offs + len <= c->leb_size);
+
+	if (!c->ra_buf) {
+		c->ra_buf = vmalloc(c->leb_size);
+		if (!c->ra_buf)
+			return -ENOMEM;
+		c->ra_lnum = -1;
+	}
+
+	if (lnum != c->ra_lnum || offs < c->ra_offs) {
+		start = offs - offs % c->min_io_size;
+		dbg_io("LEB %d:%d, read-ahead %d bytes", lnum, start,
+		       c->leb_size - start);
+		err = ubi_read(c->ubi, lnum, c->ra_buf + start, start,
+			       c->leb_size - start);
+		if (err && err != -EBADMSG) {
+			ubifs_err("cannot read-ahead LEB %d:%d, error %d",
+				  lnum, start, err);
+			c->ra_lnum = -1;
+			return err;
+		}
+		/* keep a window with ECC errors for this call only */
+		c->ra_lnum = err ? -1 : lnum;
+		c->ra_offs = start;
+		*data = c->ra_buf + offs;
+		return err;
+	}
+
+	*data = c->ra_buf + offs;
+	return 0;
+}
+#endif
+
 /**
  * ubifs_read_node - read node.
  * @c: UBIFS file-system description object
@@ -845,6 +845,9 @@ void ubifs_umount(struct ubifs_info *c)
 	vfree(c->ileb_buf);
 	vfree(c->sbuf);
 	kfree(c->bottom_up_buf);
+#ifdef CONFIG_UBIFS_BULK_READ
+	vfree(c->ra_buf);
+#endif
 	ubifs_debugging_exit(c);
 
 	/* Finally free U-Boot's global copy of superblock */
@@ -1686,7 +1686,11 @@ int ubifs_tnc_bulk_read(struct ubifs_info *c, struct bu_info *bu)
 	}
 
 	/* Do the read */
+#ifdef CONFIG_UBIFS_BULK_READ
+	err = ubifs_leb_read_ra(c, lnum, offs, len, &bu->buf);
+#else
 	err = ubi_read(c->ubi, lnum, bu->buf, offs, len);
+#endif
 
 	/* Check for a race with GC */
 	if (maybe_leb_gced(c, lnum, bu->gc_seq))
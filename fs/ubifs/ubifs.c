@@ -519,23 +519,16 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+/*
+ * Uncompress data node @dn of @block into @addr, zero-filling the rest of the
+ * block.
+ */
+static int decode_block(struct ubifs_info *c, struct inode *inode, void *addr,
+			unsigned int block, struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -566,6 +559,25 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	int err;
+	union ubifs_key key;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decode_block(c, inode, addr, block, dn);
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		       struct page *page, int last_block_size)
 {
@@ -677,6 +689,92 @@ error:
 	return err;
 }
 
+#ifdef CONFIG_UBIFS_BULK_READ
+/*
+ * Load the first @size bytes of @inode to @addr a bulk-read at a time: the
+ * TNC is walked for up to UBIFS_MAX_BULK_READ consecutive data nodes which
+ * sit back to back in one LEB, they are read in one go through the LEB
+ * read-ahead window and uncompressed straight from there. Blocks without a
+ * data node are holes.
+ */
+static int bulk_load(struct ubifs_info *c, struct inode *inode, void *addr,
+		     u32 size)
+{
+	struct bu_info *bu = &c->bu;
+	unsigned int block = 0, count, i, n;
+	void *buf, *tmp = NULL;
+	int err = 0;
+
+	count = (size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
+	ubifs_ra_invalidate(c);
+
+	while (block < count) {
+		data_key_init(c, &bu->key, inode->i_ino, block);
+		bu->buf_len = c->leb_size;
+		err = ubifs_tnc_get_bu_keys(c, bu);
+		if (err)
+			break;
+
+		if (!bu->cnt && bu->eof) {
+			/* No more data nodes, the rest is a hole */
+			memset(addr + block * UBIFS_BLOCK_SIZE, 0,
+			       size - block * UBIFS_BLOCK_SIZE);
+			break;
+		}
+		if (!bu->blk_cnt) {
+			err = -EINVAL;
+			break;
+		}
+
+		if (bu->cnt) {
+			err = ubifs_tnc_bulk_read(c, bu);
+			if (err)
+				break;
+		}
+
+		buf = bu->buf;
+		n = 0;
+		for (i = 0; i < bu->blk_cnt && block < count; i++, block++) {
+			void *dst = addr + block * UBIFS_BLOCK_SIZE;
+			u32 left = size - block * UBIFS_BLOCK_SIZE;
+
+			if (n == bu->cnt ||
+			    key_block(c, &bu->zbranch[n].key) != block) {
+				memset(dst, 0, min_t(u32, left,
+						     UBIFS_BLOCK_SIZE));
+				continue;
+			}
+
+			/* Do not pad the destination past @size */
+			if (left < UBIFS_BLOCK_SIZE) {
+				if (!tmp)
+					tmp = malloc(UBIFS_BLOCK_SIZE);
+				if (!tmp) {
+					err = -ENOMEM;
+					break;
+				}
+				err = decode_block(c, inode, tmp, block, buf);
+				memcpy(dst, tmp, left);
+			} else
+				err = decode_block(c, inode, dst, block, buf);
+			if (err)
+				break;
+
+			buf += ALIGN(bu->zbranch[n].len, 8);
+			n += 1;
+		}
+		if (err)
+			break;
+	}
+
+	free(tmp);
+	if (err)
+		ubifs_err("cannot bulk-read block %u of inode %lu, error %d",
+			  block, inode->i_ino, err);
+	return err;
+}
+#endif
+
 int ubifs_load(char *filename, u32 addr, u32 size)
 {
 	struct ubifs_info *c = ubifs_sb->s_fs_info;
@@ -718,6 +816,11 @@ int ubifs_load(char *filename, u32 addr, u32 size)
 	printf("Loading file '%s' to addr 0x%08x with size %d (0x%08x)...\n",
 	       filename, addr, size, size);
 
+#ifdef CONFIG_UBIFS_BULK_READ
+	/* The block at a time loop below is the fall-back */
+	if (!bulk_load(c, inode, (void *)addr, size))
+		count = 0;
+#endif
 	page.addr = (void *)addr;
 	page.index = 0;
 	page.inode = inode;
@@ -1191,7 +1191,8 @@ struct ubifs_znode {
  * struct bu_info - bulk-read information.
  * @key: first data node key
  * @zbranch: zbranches of data nodes to bulk read
- * @buf: buffer to read into
+ * @buf: buffer to read into, with %CONFIG_UBIFS_BULK_READ this is pointed
+ *       into the LEB read-ahead window instead
  * @buf_len: buffer length
  * @gc_seq: GC sequence number to detect races with GC
  * @cnt: number of data nodes for bulk read
@@ -1417,6 +1418,9 @@ struct ubifs_debug_info;
  * @max_bu_buf_len: maximum bulk-read buffer length
  * @bu_mutex: protects the pre-allocated bulk-read buffer and @c->bu
  * @bu: pre-allocated bulk-read information
+ * @ra_buf: LEB read-ahead window for bulk-reads
+ * @ra_lnum: LEB held in @ra_buf, %-1 if the window is empty
+ * @ra_offs: offset in @ra_lnum the window starts at, it runs to the LEB end
  *
  * @log_lebs: number of logical eraseblocks in the log
  * @log_bytes: log size in bytes
@@ -1656,6 +1660,11 @@ struct ubifs_info {
 	int max_bu_buf_len;
 	struct mutex bu_mutex;
 	struct bu_info bu;
+#ifdef CONFIG_UBIFS_BULK_READ
+	void *ra_buf;
+	int ra_lnum;
+	int ra_offs;
+#endif
 
 	int log_lebs;
 	long long log_bytes;
@@ -1844,6 +1853,11 @@ int ubifs_read_node(const struct ubifs_info *c, void *buf, int type, int len,
 		    int lnum, int offs);
 int ubifs_read_node_wbuf(struct ubifs_wbuf *wbuf, void *buf, int type, int len,
 			 int lnum, int offs);
+#ifdef CONFIG_UBIFS_BULK_READ
+int ubifs_leb_read_ra(struct ubifs_info *c, int lnum, int offs, int len,
+		      void **data);
+void ubifs_ra_invalidate(struct ubifs_info *c);
+#endif
 int ubifs_write_node(struct ubifs_info *c, void *node, int len, int lnum,
 		     int offs, int dtype);
 int ubifs_check_node(const struct ubifs_info *c, const void *buf, int lnum,
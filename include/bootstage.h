@@ -206,6 +206,12 @@ enum bootstage_id {
 	BOOTSTAGE_ID_MAIN_CPU_READY,
 
 	BOOTSTAGE_ID_ACCUM_LCD,
+	BOOTSTAGE_ID_ACCUM_SFC_READ,
+
+	BOOTSTAGE_ID_SPL_PLL_INIT,
+	BOOTSTAGE_ID_SPL_SDRAM_INIT,
+	BOOTSTAGE_ID_SPL_FLASH_PROBE,
+	BOOTSTAGE_ID_END_SPL,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -213,6 +219,30 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ALLOC,
 };
 
+/*
+ * Layout of the stash area. The SPL writes the same format, so the records
+ * it took survive the handoff and show up in the U-Boot report.
+ */
+enum {
+	BOOTSTAGE_VERSION	= 0,
+	BOOTSTAGE_MAGIC		= 0xb00757a3,
+};
+
+struct bootstage_record {
+	ulong time_us;
+	uint32_t start_us;
+	const char *name;
+	int flags;		/* see enum bootstage_flags */
+	enum bootstage_id id;
+};
+
+struct bootstage_hdr {
+	uint32_t version;	/* BOOTSTAGE_VERSION */
+	uint32_t count;		/* Number of records */
+	uint32_t size;		/* Total data size (non-zero if valid) */
+	uint32_t magic;		/* Unused */
+};
+
 /*
  * Return the time since boot in microseconds, This is needed for bootstage
  * and should be defined in CPU- or board-specific code. If undefined then
@@ -337,6 +367,31 @@ int bootstage_stash(void *base, int size);
  */
 int bootstage_unstash(void *base, int size);
 
+/**
+ * Append "bootstage_stash=<addr>" to a kernel command line
+ *
+ * For kernels that get no device tree.  The caller stashes the timeline
+ * at CONFIG_BOOTSTAGE_STASH right before it jumps to the kernel.
+ *
+ * @param commandline	Command line to extend, may be NULL
+ * @return static buffer holding the new command line
+ */
+char *bootstage_stash_cmdline(const char *commandline);
+
+#elif defined(CONFIG_SPL_BOOTSTAGE) && defined(CONFIG_SPL_BUILD)
+/*
+ * The SPL only records marks into a small table and stashes them for
+ * U-Boot before jumping, see common/spl/spl_bootstage.c.
+ */
+ulong bootstage_mark_name(enum bootstage_id id, const char *name);
+
+static inline ulong bootstage_mark(enum bootstage_id id)
+{
+	return bootstage_mark_name(id, NULL);
+}
+
+int bootstage_stash(void *base, int size);
+
 #else
 static inline ulong bootstage_add_record(enum bootstage_id id,
 		const char *name, int flags, ulong mark)
@@ -784,6 +784,13 @@ void	flush_dcache_range(unsigned long start, unsigned long stop);
 void	invalidate_dcache_range(unsigned long start, unsigned long stop);
 void	invalidate_dcache_all(void);
 void	invalidate_icache_all(void);
+#ifdef CONFIG_MIPS
+/* arch/mips/cpu/xburst/cpu.c, the _nosync ops leave cache_sync() to the caller */
+void	flush_cache_all(void);
+void	flush_dcache_range_nosync(unsigned long start, unsigned long stop);
+void	writeback_dcache_range(unsigned long start, unsigned long stop);
+void	cache_sync(void);
+#endif
 
 /* arch/$(ARCH)/lib/ticks.S */
 unsigned long long get_ticks(void);
@@ -797,6 +804,7 @@ int	init_timebase (void);
 
 /* lib/gunzip.c */
 int gunzip(void *, int, unsigned char *, unsigned long *);
+int gzip_parse_header(const unsigned char *src, unsigned long len);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
 
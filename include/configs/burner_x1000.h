@@ -256,6 +256,7 @@
 #define	CONFIG_JZ_VERDOR_BURN_FUNCTION
 #define CONFIG_USB_JZ_DWC2_UDC_V1_1
 #define CONFIG_USB_SELF_POLLING
+#define CONFIG_CLONER_PIPELINE		/*program chunk n while chunk n+1 is received*/
 #define CONFIG_USB_PRODUCT_ID  0x4775
 #define CONFIG_USB_VENDOR_ID   0xa108
 #define CONFIG_BURNER_CPU_INFO "BOOT4775"
@@ -59,6 +59,7 @@
 #endif
 
 /*#define CONFIG_DDR_TEST*/
+/*#define CONFIG_DDR_TEST_PARALLEL*/	/* CPU + PDMA pattern test, needs CONFIG_DDR_TEST */
 #define CONFIG_DDR_PARAMS_CREATOR
 #define CONFIG_DDR_HOST_CC
 #define CONFIG_DDR_TYPE_LPDDR
@@ -155,6 +156,11 @@
 #endif
 
 #ifdef CONFIG_SPL_OS_BOOT
+#if defined(CONFIG_SPL_SFC_NAND) /* sfcnand spl boot kernel */
+#define CONFIG_SPL_OS_OFFSET        (0x100000) /* nand offset of uImage being loaded */
+#define CONFIG_SPL_BOOTARGS         BOOTARGS_COMMON "ip=off init=/linuxrc ubi.mtd=2 root=ubi0:rootfs ubi.mtd=3 rootfstype=ubifs rw"
+#define CONFIG_SYS_SPL_ARGS_ADDR    CONFIG_SPL_BOOTARGS
+#else
 #ifdef CONFIG_NOR_SPL_BOOT_OS /* norflash spl boot kernel */
 #ifndef CONFIG_OTA_VERSION20
 #define CONFIG_SPL_OS_OFFSET        (0x40000) /* spi offset of xImage being loaded */
@@ -184,6 +190,16 @@
 #undef  CONFIG_BOOTCOMMAND
 #define CONFIG_BOOTCOMMAND    "bootx sfc 0x80f00000"
 #endif	/* CONFIG_OTA_VERSION20 */
+#endif	/* CONFIG_SPL_SFC_NAND */
+
+/* falcon mode: lzo uImage, boot key and environment fallback to u-boot */
+#define CONFIG_SPL_LZO
+#define CONFIG_SPL_OS_LOAD_ADDR         0x80f00000 /* compressed kernel is staged here */
+#define CONFIG_SPL_OS_BOOT_GPIO         CONFIG_GPIO_PWR_WAKE
+#define CONFIG_SPL_OS_BOOT_GPIO_ENLEVEL CONFIG_GPIO_PWR_WAKE_ENLEVEL
+#if defined(CONFIG_ENV_IS_IN_SFC) || defined(CONFIG_SPL_SFC_NAND)
+#define CONFIG_SPL_OS_BOOT_ENV      /* honour spl_boot_os and spl_bootargs */
+#endif
 #endif	/* CONFIG_SPL_OS_BOOT */
 
 
@@ -251,6 +267,8 @@
 #define CONFIG_NET_PHY_TYPE   PHY_TYPE_DM9161
 
 #define CONFIG_NET_GMAC
+#define CONFIG_SYS_RX_ETH_BUFFER	16	/* rx ring, reaped in batches */
+#define CONFIG_TFTP_WINDOWSIZE		8	/* half the rx ring per ACK */
 #define CONFIG_GPIO_DM9161_RESET   GPIO_PC(23)
 #define CONFIG_GPIO_DM9161_RESET_ENLEVEL   0
 #define CONFIG_GMAC_CRLT_PORT GPIO_PORT_B
@@ -311,6 +329,7 @@
 #define CONFIG_GENERIC_MMC		1
 #define CONFIG_MMC			1
 #define CONFIG_JZ_MMC			1
+#define CONFIG_JZ_MMC_DMA		/* descriptor DMA for aligned block transfers */
 
 #ifdef CONFIG_JZ_MMC_MSC0
 #define CONFIG_JZ_MMC_SPLMSC 0
@@ -342,6 +361,22 @@
 
 #define CONFIG_LZO
 #define CONFIG_RBTREE
+#define CONFIG_CRC32_SLICE_BY_4	/* 4KB of tables, half of slice-by-8 */
+#define CONFIG_JZ_PDMA		/* cp/bootm/logo copies above 64KB on the PDMA */
+#define CONFIG_CMD_DMATEST
+#define CONFIG_CMD_CACHEBENCH
+
+/*
+ * Boot time profiling: the SPL marks are stashed below the kernel, merged
+ * by U-Boot and handed on to Linux with "bootstage_stash=" on its cmdline.
+ */
+#ifdef CONFIG_BOOTSTAGE
+#define CONFIG_SPL_BOOTSTAGE
+#define CONFIG_BOOTSTAGE_REPORT
+#define CONFIG_CMD_BOOTSTAGE
+#define CONFIG_BOOTSTAGE_STASH		0x80001000
+#define CONFIG_BOOTSTAGE_STASH_SIZE	0x1000
+#endif
 
 #define CONFIG_SKIP_LOWLEVEL_INIT
 #define CONFIG_BOARD_EARLY_INIT_F
@@ -451,6 +486,11 @@
 #define CONFIG_SPL_SFC_NAND
 #define CONFIG_MTD_SFCNAND
 #define CONFIG_JZ_SFC
+#define CONFIG_JZ_SFC_DMA
+#define CONFIG_JZ_SFC_AUTO_POLL
+#define CONFIG_SPI_QUAD			/* x4 read from cache, sets the QE feature bit */
+#define CONFIG_SFC_NAND_SEQ_READ	/* 0x31/0x3f cache read, drop for a chip without it */
+#define CONFIG_SFC_NAND_CACHE		/* LRU page cache, 1/16 of the malloc heap */
 #define CONFIG_CMD_SFCNAND
 #define CONFIG_CMD_NAND
 #define CONFIG_SPI_SPL_CHECK
@@ -493,7 +533,9 @@
 #define CONFIG_CMD_SPINAND
 #define CONFIG_SPI_FLASH
 #define CONFIG_CMD_UBI
+#define CONFIG_MTD_UBI_FASTMAP		/* attach from a fastmap if there is one */
 #define CONFIG_CMD_UBIFS
+#define CONFIG_UBIFS_BULK_READ		/* ubifsload a LEB range per read */
 #define CONFIG_MTD_PARTITIONS
 #define CONFIG_CMD_MTDPARTS
 #define CONFIG_ENV_IS_IN_SPI_NAND
@@ -534,6 +576,8 @@
 #ifdef CONFIG_CMD_SFC_NOR
 #define CONFIG_JZ_SFC
 #define CONFIG_JZ_SFC_NOR
+#define CONFIG_JZ_SFC_DMA
+#define CONFIG_JZ_SFC_AUTO_POLL
 /*#define CONFIG_SPI_DUAL*/
 #define CONFIG_SPI_QUAD
 #endif
@@ -545,6 +589,17 @@
 #define CONFIG_NOR_MINOR_VERSION_NUMBER     0
 #define CONFIG_NOR_REVERSION_NUMBER     0
 #define CONFIG_NOR_VERSION     (CONFIG_NOR_MAJOR_VERSION_NUMBER | (CONFIG_NOR_MINOR_VERSION_NUMBER << 8) | (CONFIG_NOR_REVERSION_NUMBER <<16))
+
+/* fsload/ls on the jffs2 rootfs, mtdblock2 after u-boot and the kernel */
+#define CONFIG_CMD_JFFS2
+#define CONFIG_JFFS2_DEV		"nor0"
+#define CONFIG_JFFS2_PART_OFFSET	0x340000
+#define CONFIG_JFFS2_SUMMARY
+#define CONFIG_JFFS2_NODE_INDEX		/* unchanged blocks are not walked again */
+
+/* flash 0 - 4M read on demand into dram reserved on top, above u-boot */
+#define CONFIG_SFC_NOR_SHADOW
+#define CONFIG_SFC_NOR_SHADOW_SIZE	(4 << 20)
 #endif
 /**
  * MBR configuration
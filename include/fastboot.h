@@ -37,4 +37,50 @@ struct partition_info {
 	unsigned long offset;
 	unsigned long size;
 };
+
+/* flash write-back buffer, the unit writes are gathered into */
+#ifndef CONFIG_FASTBOOT_FLASH_BUF
+#define CONFIG_FASTBOOT_FLASH_BUF	(1024 * 1024)
+#endif
+
+/*
+ * Image writer of a flash command. The image is fed in pieces of any size
+ * as they come off the USB, an Android sparse image is expanded on the fly
+ * (raw, fill and don't care chunks), anything else is written as is from
+ * the start of the partition.
+ */
+struct fb_flash {
+	struct partition_info	*part;
+	int			err;
+	unsigned int		unit;		/* device write unit */
+
+	/* sparse parser */
+	int			state;
+	unsigned int		hdr[7];		/* file or chunk header so far */
+	unsigned int		hdr_len;
+	unsigned int		skip;		/* bytes to drop */
+	unsigned int		need;		/* bytes left in the chunk */
+	unsigned int		chunk_hdr_sz;
+	unsigned int		blk_sz;
+	unsigned int		chunks;		/* chunks left */
+
+	/* write-back buffer, holding the bytes before @off */
+	unsigned long		off;		/* in the partition */
+	unsigned char		*buf;
+	unsigned long		buf_off;
+	unsigned int		buf_len;
+
+	/* NAND: blocks erased in this pass and the bad block skip map */
+	unsigned long		erased;
+	unsigned long		map_lblk;
+	unsigned long		map_pofs;
+	unsigned char		*blk_buf;
+};
+
+/* drivers/usb/gadget/fastboot_flash.c */
+int fb_flash_open(struct fb_flash *ff, struct partition_info *part);
+int fb_flash_write(struct fb_flash *ff, const void *data, unsigned int len);
+/* flush, free and return the first error of the pass */
+int fb_flash_close(struct fb_flash *ff);
+int fb_flash_erase(struct partition_info *part);
 #endif
@@ -281,6 +281,10 @@ void	lcd_puts(const char *s);
 void	lcd_printf(const char *fmt, ...);
 void	lcd_clear(void);
 void	lcd_clear_black(void);
+#ifdef CONFIG_JZ_LCD_V13
+void	fb_flush(void *fb_addr, int count);
+void	fb_clear(void *fb_addr, int count);
+#endif
 int	lcd_display_bitmap(ulong bmp_image, int x, int y);
 
 /**
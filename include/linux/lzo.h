@@ -31,6 +31,9 @@ int lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
 int lzop_decompress(const unsigned char *src, size_t src_len,
 		    unsigned char *dst, size_t *dst_len);
 
+/* skip the lzop file header, returns the first block or NULL */
+const unsigned char *lzop_parse_header(const unsigned char *src);
+
 /*
  * Return values (< 0 = Error)
  */
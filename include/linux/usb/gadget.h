@@ -859,5 +859,7 @@ extern struct usb_ep *usb_ep_autoconfig(struct usb_gadget *,
 extern void usb_ep_autoconfig_reset(struct usb_gadget *);
 
 extern int usb_gadget_handle_interrupts(void);
+extern void usb_gadget_idle(void);
+extern void usb_gadget_poll_out(void);
 
 #endif	/* __LINUX_USB_GADGET_H */
@@ -29,6 +29,8 @@
 uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
+/* byte-at-a-time reference, crc32_no_comp() may use slicing tables */
+uint32_t crc32_bytewise (uint32_t, const unsigned char *, uint);
 
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
@@ -164,6 +164,83 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+/*
+ * Slicing-by-N: N tables, table k holding the CRC of a byte followed by k
+ * zero bytes, fold N input bytes per step instead of one. Slice-by-4 keeps
+ * the 4KB of tables comfortably inside a 16KB D-cache, slice-by-8 (8KB) is
+ * faster when the data cache can spare it. The host tools always use 8.
+ */
+#if defined(USE_HOSTCC) || defined(CONFIG_CRC32_SLICE_BY_8)
+#define CRC32_SLICES	8
+#elif defined(CONFIG_CRC32_SLICE_BY_4)
+#define CRC32_SLICES	4
+#endif
+
+/* the tables would not fit the SPL, and the word loads assume LE */
+#if __BYTE_ORDER != __LITTLE_ENDIAN || defined(CONFIG_SPL_BUILD)
+#undef CRC32_SLICES
+#endif
+
+#ifdef CRC32_SLICES
+local int crc_slice_table_empty = 1;
+local uint32_t crc_slice_table[CRC32_SLICES][256];
+
+local void make_crc_slice_table(void)
+{
+	uint32_t c;
+	int n, k;
+
+#ifdef DYNAMIC_CRC_TABLE
+	if (crc_table_empty)
+		make_crc_table();
+#endif
+	for (n = 0; n < 256; n++) {
+		c = crc_table[n];
+		crc_slice_table[0][n] = c;
+		for (k = 1; k < CRC32_SLICES; k++) {
+			c = crc_table[c & 0xff] ^ (c >> 8);
+			crc_slice_table[k][n] = c;
+		}
+	}
+	crc_slice_table_empty = 0;
+}
+
+local uint32_t crc32_slice(uint32_t crc, const uint8_t *p, uInt len)
+{
+	const uint32_t (*t)[256] = (const uint32_t (*)[256])crc_slice_table;
+	uint32_t one;
+#if CRC32_SLICES == 8
+	uint32_t two;
+#endif
+
+	if (crc_slice_table_empty)
+		make_crc_slice_table();
+
+	for (; len && ((long)p & 3); len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	for (; len >= CRC32_SLICES; len -= CRC32_SLICES) {
+		one = *(const uint32_t *)p ^ crc;
+#if CRC32_SLICES == 8
+		two = *(const uint32_t *)(p + 4);
+		crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^
+		      t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+		      t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+		      t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+#else
+		crc = t[3][one & 0xff] ^ t[2][(one >> 8) & 0xff] ^
+		      t[1][(one >> 16) & 0xff] ^ t[0][one >> 24];
+#endif
+		p += CRC32_SLICES;
+	}
+
+	for (; len; len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+#endif
+
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -173,10 +250,9 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
+/* Byte table version, kept as the reference for crc32 -b and crc32bench.
  */
-uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+uint32_t ZEXPORT crc32_bytewise(uint32_t crc, const Bytef *buf, uInt len)
 {
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
@@ -218,6 +294,18 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 }
 #undef DO_CRC
 
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+#ifdef CRC32_SLICES
+	return crc32_slice(crc, buf, len);
+#else
+	return crc32_bytewise(crc, buf, len);
+#endif
+}
+
 uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
 {
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
@@ -53,7 +53,11 @@ void gzfree(void *x, void *addr, unsigned nb)
 	free (addr);
 }
 
-int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+/*
+ * Return the size of the gzip header at @src, -1 if it is not a deflate
+ * stream or does not fit in @len bytes.
+ */
+int gzip_parse_header(const unsigned char *src, unsigned long len)
 {
 	int i, flags;
 
@@ -74,11 +78,22 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 			;
 	if ((flags & HEAD_CRC) != 0)
 		i += 2;
-	if (i >= *lenp) {
+	if (i >= len) {
 		puts ("Error: gunzip out of data in header\n");
 		return (-1);
 	}
 
+	return i;
+}
+
+int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+{
+	int i;
+
+	i = gzip_parse_header(src, *lenp);
+	if (i < 0)
+		return (-1);
+
 	return zunzip(dst, dstlen, src, lenp, 1, i);
 }
 
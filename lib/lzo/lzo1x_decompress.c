@@ -16,6 +16,11 @@
 #include <asm/byteorder.h>
 #include <asm/unaligned.h>
 #include "lzodefs.h"
+#if defined(CONFIG_JZ_PDMA) && !defined(CONFIG_SPL_BUILD)
+#include <asm/arch/dma.h>
+#else
+#define dma_memcpy	memcpy
+#endif
 
 #define HAVE_IP(x, ip_end, ip) ((size_t)(ip_end - ip) < (x))
 #define HAVE_OP(x, op_end, op) ((size_t)(op_end - op) < (x))
@@ -30,7 +35,7 @@ static const unsigned char lzop_magic[] = {
 
 #define HEADER_HAS_FILTER	0x00000800L
 
-static inline const unsigned char *parse_header(const unsigned char *src)
+const unsigned char *lzop_parse_header(const unsigned char *src)
 {
 	u16 version;
 	int i;
@@ -71,7 +76,7 @@ int lzop_decompress(const unsigned char *src, size_t src_len,
 	size_t tmp;
 	int r;
 
-	src = parse_header(src);
+	src = lzop_parse_header(src);
 	if (!src)
 		return LZO_E_ERROR;
 
@@ -93,15 +98,20 @@ int lzop_decompress(const unsigned char *src, size_t src_len,
 		if (slen <= 0 || slen > dlen)
 			return LZO_E_ERROR;
 
-		/* decompress */
-		tmp = dlen;
-		r = lzo1x_decompress_safe((u8 *) src, slen, dst, &tmp);
+		if (slen == dlen) {
+			/* incompressible block, stored as is */
+			dma_memcpy(dst, src, dlen);
+		} else {
+			/* decompress */
+			tmp = dlen;
+			r = lzo1x_decompress_safe((u8 *) src, slen, dst, &tmp);
 
-		if (r != LZO_E_OK)
-			return r;
+			if (r != LZO_E_OK)
+				return r;
 
-		if (dlen != tmp)
-			return LZO_E_ERROR;
+			if (dlen != tmp)
+				return LZO_E_ERROR;
+		}
 
 		src += slen;
 		dst += dlen;
@@ -130,6 +130,23 @@ static char tftp_filename[MAX_LEN];
 static unsigned short TftpBlkSize = TFTP_BLOCK_SIZE;
 static unsigned short TftpBlkSizeOption = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440: the server sends a window of blocks per ACK. We only ACK the
+ * last block of a window, a short block, or the last in-order block once
+ * a gap shows up so the server resends from there.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+
+static unsigned short TftpWindowSize = 1;
+static unsigned short TftpWindowSizeOption = TFTP_WINDOWSIZE;
+static unsigned short TftpNextAck;	/* block that closes the window */
+static ulong TftpLastNack = -1;	/* in-order block a gap was reported at */
+static unsigned short TftpNackDrops;	/* blocks dropped since that report */
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -201,6 +218,8 @@ static void new_transfer(void)
 	TftpLastBlock = 0;
 	TftpBlockWrap = 0;
 	TftpBlockWrapOffset = 0;
+	TftpLastNack = -1;
+	TftpNackDrops = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	TftpFinalBlock = 0;
 #endif
@@ -359,6 +378,9 @@ TftpSend(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, TftpBlkSizeOption, 0);
+		if (TftpState == STATE_SEND_RRQ && TftpWindowSizeOption > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, TftpWindowSizeOption, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!ProhibitMcast) {
@@ -390,6 +412,8 @@ TftpSend(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(TftpBlock);
 		pkt = (uchar *)(s + 2);
+		/* the server answers with the next window */
+		TftpNextAck = TftpBlock + TftpWindowSize;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (TftpWriting) {
 			int toload = TftpBlkSize;
@@ -528,6 +552,13 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 				debug("Blocksize ack: %s, %d\n",
 					(char *)pkt+i+8, TftpBlkSize);
 			}
+			if (strcmp((char *)pkt+i, "windowsize") == 0) {
+				TftpWindowSize = (unsigned short)
+					simple_strtoul((char *)pkt+i+11, NULL,
+						       10);
+				debug("Windowsize ack: %s, %d\n",
+					(char *)pkt+i+11, TftpWindowSize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				TftpTsize = simple_strtoul((char *)pkt+i+6,
@@ -537,8 +568,13 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			}
 #endif
 		}
+		if (!TftpWindowSize)
+			TftpWindowSize = 1;
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len-1);
+		/* multicast keeps its own bitmap driven ACKs */
+		if (Multicast)
+			TftpWindowSize = 1;
 		if ((Multicast) && (!MasterClient))
 			TftpState = STATE_DATA;	/* passive.. */
 		else
@@ -556,6 +592,33 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		if (len < 2)
 			return;
 		len -= 2;
+
+		if (TftpWindowSize > 1 && TftpState == STATE_DATA) {
+			unsigned short block = ntohs(*(__be16 *)pkt);
+			unsigned short ahead = block - (TftpLastBlock + 1);
+
+			if (ahead) {
+				/*
+				 * A resent window gives blocks behind us, just
+				 * drop them. Blocks ahead mean one got lost:
+				 * ACK the last in-order block and the server
+				 * restarts the window there. Do it once per
+				 * gap, and again if a whole window goes by
+				 * without the missing block (ACK or resent
+				 * block lost as well).
+				 */
+				if (ahead < 0x8000 &&
+				    (TftpLastNack != TftpLastBlock ||
+				     ++TftpNackDrops >= TftpWindowSize)) {
+					TftpLastNack = TftpLastBlock;
+					TftpNackDrops = 0;
+					TftpBlock = TftpLastBlock;
+					TftpSend();
+				}
+				break;
+			}
+		}
+
 		TftpBlock = ntohs(*(__be16 *)pkt);
 
 		update_block_number();
@@ -593,6 +656,8 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		}
 
 		TftpLastBlock = TftpBlock;
+		TftpLastNack = -1;
+		TftpNackDrops = 0;
 		TftpTimeoutCountMax = TIMEOUT_COUNT;
 		NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
 
@@ -627,7 +692,9 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			}
 		}
 #endif
-		TftpSend();
+		if (TftpWindowSize == 1 || len < TftpBlkSize ||
+		    (unsigned short)TftpBlock == TftpNextAck)
+			TftpSend();
 
 #ifdef CONFIG_MCAST_TFTP
 		if (Multicast) {
@@ -701,6 +768,10 @@ void TftpStart(enum proto_t protocol)
 	if (ep != NULL)
 		TftpTimeoutMSecs = simple_strtol(ep, NULL, 10);
 
+	ep = getenv("tftpwindowsize");
+	if (ep != NULL)
+		TftpWindowSizeOption = simple_strtol(ep, NULL, 10);
+
 	if (TftpTimeoutMSecs < 1000) {
 		printf("TFTP timeout (%ld ms) too low, "
 			"set minimum = 1000 ms\n",
@@ -708,8 +779,8 @@ void TftpStart(enum proto_t protocol)
 		TftpTimeoutMSecs = 1000;
 	}
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-		TftpBlkSizeOption, TftpTimeoutMSecs);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+		TftpBlkSizeOption, TftpWindowSizeOption, TftpTimeoutMSecs);
 
 	TftpRemoteIP = NetServerIP;
 	if (BootFile[0] == '\0') {
@@ -807,8 +878,9 @@ void TftpStart(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(NetServerEther, 0, 6);
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -837,8 +909,9 @@ TftpStartServer(void)
 	TftpTimeoutMSecs = TIMEOUT;
 	NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
 
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 	TftpBlock = 0;
 	TftpOurPort = WELL_KNOWN_PORT;
 
@@ -0,0 +1,80 @@
+/*
+ * crc32bench - compare the byte table CRC32 with the sliced one in
+ * lib/crc32.c on the build host.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <u-boot/crc.h>
+
+#define DEFAULT_SIZE	(64 << 20)
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double run(uint32_t (*fn)(uint32_t, const unsigned char *, uint),
+		  const unsigned char *buf, size_t size, uint32_t *crc)
+{
+	double start = now();
+
+	/* an odd start exercises the unaligned head as well */
+	*crc = fn(0xffffffff, buf + 1, size - 1);
+	return (size - 1) / (now() - start) / (1 << 20);
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = DEFAULT_SIZE, i;
+	unsigned char *buf;
+	uint32_t crc_byte, crc_slice;
+	double byte_mbs, slice_mbs;
+
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 0);
+	if (size < 2) {
+		fprintf(stderr, "usage: %s [bytes]\n", argv[0]);
+		return 1;
+	}
+
+	buf = malloc(size);
+	if (!buf) {
+		perror("malloc");
+		return 1;
+	}
+	srand(1);
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+
+	/* warm the tables and the buffer */
+	crc32_no_comp(0, buf, size);
+
+	byte_mbs = run(crc32_bytewise, buf, size, &crc_byte);
+	slice_mbs = run(crc32_no_comp, buf, size, &crc_slice);
+
+	printf("byte table: %8.1f MB/s  crc %08x\n", byte_mbs, crc_byte);
+	printf("sliced:     %8.1f MB/s  crc %08x\n", slice_mbs, crc_slice);
+	free(buf);
+
+	if (crc_byte != crc_slice) {
+		fprintf(stderr, "crc mismatch\n");
+		return 1;
+	}
+	return 0;
+}